@@ -0,0 +1,177 @@
+#include "all-paths.h"
+#include <stdio.h>
+using namespace std;
+
+static const unsigned int kDigitBase = 1000000000;   // each element holds nine decimal digits
+
+// sum += addend, for big integers stored as base 10^9 digits
+static void addCount(vector<unsigned int>& sum, const vector<unsigned int>& addend)
+{
+  if (sum.size() < addend.size()) sum.resize(addend.size(), 0);
+  unsigned int carry = 0;
+  for (int i = 0; i < (int) sum.size(); i++) {
+    unsigned int digit = sum[i] + carry + (i < (int) addend.size() ? addend[i] : 0);
+    carry = digit >= kDigitBase;
+    sum[i] = carry ? digit - kDigitBase : digit;
+    if (carry == 0 && i >= (int) addend.size()) return;
+  }
+  if (carry != 0) sum.push_back(carry);
+}
+
+allShortestPaths::allShortestPaths(const graph& g, int source, int target, int maxDegrees,
+                                   const queryFilter *filter) :
+  g(g), filter(filter), source(source), target(target), length(-1)
+{
+  if (filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target))) return;
+  if (source == target) {
+    length = 0;
+    count.assign(1, 1);
+    level[source] = 0;
+    pushFrame(source, -1);
+    return;
+  }
+
+  // forward: distances from the source, through the level holding the target
+  vector<int> distance(g.getActorCount(), -1);
+  vector<bool> seenFilms(g.getMovieCount(), false);
+  vector<vector<int> > levels(1, vector<int>(1, source));
+  distance[source] = 0;
+  bool reached = false;
+  for (int depth = 0; depth < maxDegrees && !reached && !levels[depth].empty(); depth++) {
+    vector<int> next;
+    for (int i = 0; i < (int) levels[depth].size(); i++) {
+      int actor = levels[depth][i];
+      for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++) {
+        if (seenFilms[*movie] || !allowsMovie(*movie)) continue;
+        seenFilms[*movie] = true;
+        for (const int *costar = g.castBegin(*movie); costar != g.castEnd(*movie); costar++) {
+          if (distance[*costar] != -1) continue;
+          if (filter != NULL && !filter->allowsActor(*costar)) continue;
+          distance[*costar] = depth + 1;
+          next.push_back(*costar);
+          if (*costar == target) reached = true;
+        }
+      }
+    }
+    levels.push_back(next);
+  }
+  if (!reached) return;
+  length = levels.size() - 1;
+
+  // backward: keep only the actors one level closer to the target each step
+  vector<vector<int> > onPath(length + 1);
+  onPath[length].push_back(target);
+  level[target] = length;
+  for (int depth = length; depth > 0; depth--) {
+    for (int i = 0; i < (int) onPath[depth].size(); i++) {
+      int actor = onPath[depth][i];
+      for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++) {
+        if (!allowsMovie(*movie)) continue;
+        for (const int *costar = g.castBegin(*movie); costar != g.castEnd(*movie); costar++)
+          if (distance[*costar] == depth - 1 && level.insert(make_pair(*costar, depth - 1)).second)
+            onPath[depth - 1].push_back(*costar);
+      }
+    }
+  }
+
+  // counting: every movie joining consecutive levels extends every path so far
+  map<int, vector<unsigned int> > counts;
+  counts[source].assign(1, 1);
+  for (int depth = 0; depth < length; depth++) {
+    for (int i = 0; i < (int) onPath[depth].size(); i++) {
+      int actor = onPath[depth][i];
+      const vector<unsigned int>& paths = counts[actor];
+      for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++) {
+        if (!allowsMovie(*movie)) continue;
+        for (const int *costar = g.castBegin(*movie); costar != g.castEnd(*movie); costar++)
+          if (distance[*costar] == depth + 1 && level.count(*costar) > 0)
+            addCount(counts[*costar], paths);
+      }
+    }
+  }
+  count = counts[target];
+  pushFrame(source, -1);
+}
+
+string allShortestPaths::getCount() const
+{
+  if (count.empty()) return "0";
+  char group[16];
+  snprintf(group, sizeof(group), "%u", count.back());
+  string digits = group;
+  for (int i = (int) count.size() - 2; i >= 0; i--) {
+    snprintf(group, sizeof(group), "%09u", count[i]);
+    digits += group;
+  }
+  return digits;
+}
+
+bool allShortestPaths::onNextLevel(int actor, int costar) const
+{
+  map<int, int>::const_iterator found = level.find(costar);
+  return found != level.end() && found->second == level.find(actor)->second + 1;
+}
+
+void allShortestPaths::pushFrame(int actor, int via)
+{
+  frame added = { actor, via, g.creditsBegin(actor), NULL };
+  stack.push_back(added);
+}
+
+/**
+ * Method: next
+ * ------------
+ * Resumes a depth-first walk of the DAG.  The stack holds the path taken
+ * so far, and each frame remembers how far through its actor's movies and
+ * their casts it has looked.  Since every actor in the DAG leads to the
+ * target, no branch is ever a dead end.
+ */
+
+bool allShortestPaths::next(path& result)
+{
+  if (length == 0) {
+    if (stack.empty()) return false;
+    stack.clear();
+    result = path(g.getActorName(source));
+    return true;
+  }
+
+  while (!stack.empty()) {
+    int actor = stack.back().actor;
+    if (actor == target) {
+      stack.pop_back();
+      continue;
+    }
+    frame& top = stack.back();
+    int chosen = -1, via = -1;
+    while (chosen == -1 && top.movie != g.creditsEnd(actor)) {
+      if (top.costar == NULL)
+        top.costar = allowsMovie(*top.movie) ? g.castBegin(*top.movie) : g.castEnd(*top.movie);
+      while (top.costar != g.castEnd(*top.movie)) {
+        int costar = *top.costar++;
+        if (onNextLevel(actor, costar)) {
+          chosen = costar;
+          via = *top.movie;
+          break;
+        }
+      }
+      if (chosen == -1) {
+        top.movie++;
+        top.costar = NULL;
+      }
+    }
+    if (chosen == -1) {
+      stack.pop_back();
+      continue;
+    }
+
+    pushFrame(chosen, via);
+    if (chosen == target) {
+      result = path(g.getActorName(source));
+      for (int i = 1; i < (int) stack.size(); i++)
+        result.addConnection(g.getMovie(stack[i].via), g.getActorName(stack[i].actor));
+      return true;
+    }
+  }
+  return false;
+}
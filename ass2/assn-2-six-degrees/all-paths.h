@@ -0,0 +1,95 @@
+#ifndef __all_paths__
+#define __all_paths__
+
+#include "graph.h"
+#include "path.h"
+#include "search.h"
+#include "query-filter.h"
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: allShortestPaths
+ * -----------------------
+ * Finds every shortest path between two actors, where paths that differ
+ * in any actor or movie count as different.  The constructor searches
+ * outward from the source a level at a time until the level that reaches
+ * the target, then walks back from the target to keep only the actors
+ * that lie on some shortest path.  Those actors and the movies between
+ * consecutive levels form a DAG, over which the paths are counted exactly
+ * (the count can easily exceed 64 bits, so it's kept as a big integer)
+ * and enumerated lazily, one path per call to next.
+ */
+
+class allShortestPaths {
+
+ public:
+
+  /**
+   * Constructor: allShortestPaths
+   * -----------------------------
+   * Searches for the shortest paths between the two actors.
+   *
+   * @param g the graph to search; it must outlive this object.
+   * @param source the id of the actor the paths start with.
+   * @param target the id of the actor the paths end with.
+   * @param maxDegrees the longest paths worth looking for, in movies.
+   * @param filter the movies and actors the paths may use, or NULL for all;
+   *               it must outlive this object.
+   */
+
+  allShortestPaths(const graph& g, int source, int target, int maxDegrees = kMaxDegrees,
+                   const queryFilter *filter = NULL);
+
+  /**
+   * Methods: found
+   *          getLength
+   *          getCount
+   * ---------------
+   * Report whether any path was found, how many movies each shortest
+   * path has, and how many shortest paths there are, in decimal.
+   */
+
+  bool found() const { return length >= 0; }
+  int getLength() const { return length; }
+  string getCount() const;
+
+  /**
+   * Method: next
+   * ------------
+   * Produces the next shortest path, in order of actor and movie ids at
+   * each step.  Each call does work proportional to the length of the
+   * path and the movies scanned to reach it, so taking the first few of
+   * an enormous number of paths is cheap.
+   *
+   * @param result updated with the next path.
+   * @return false if and only if every path has already been produced.
+   */
+
+  bool next(path& result);
+
+ private:
+  struct frame {
+    int actor;
+    int via;                   // the movie shared with the previous actor
+    const int *movie;          // the next of the actor's credits to try
+    const int *costar;         // the next actor in *movie to try, or NULL
+  };
+
+  const graph& g;
+  const queryFilter *filter;
+  int source;
+  int target;
+  int length;
+  map<int, int> level;         // distance from the source, for actors on some shortest path
+  vector<unsigned int> count;  // base 10^9 digits, least significant first
+  vector<frame> stack;
+
+  bool allowsMovie(int movie) const { return filter == NULL || filter->allowsMovie(movie); }
+  bool onNextLevel(int actor, int costar) const;
+  void pushFrame(int actor, int via);
+};
+
+#endif
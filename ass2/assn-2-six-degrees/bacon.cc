@@ -0,0 +1,289 @@
+/**
+ * File: bacon.cc
+ * --------------
+ * Whole-graph distance computations that would otherwise take one pair
+ * query per actor.  Given a center actor, a single search finds every
+ * actor's distance (their "Bacon number") from the center, writes them
+ * to a compact binary file and prints a histogram.  With --centrality,
+ * searches from a random sample of actors, spread across all cores,
+ * estimate every actor's average distance to everyone else and rank the
+ * most central actors.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "imdb.h"
+#include "graph.h"
+#include "bfs.h"
+using namespace std;
+
+static const int kDefaultTopCount = 20;
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the two ways to run this program and the options they share.
+ */
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " [options] <actor>" << endl;
+  cerr << "       " << program << " [options] --centrality <samples>" << endl;
+  cerr << "The first form prints a histogram of every actor's distance from <actor>;" << endl;
+  cerr << "the second ranks actors by their estimated average distance to everyone else." << endl;
+  cerr << "The options are:" << endl;
+  cerr << "    --out <file>       also write every actor's distance to <file>" << endl;
+  cerr << "    --threads <n>      number of threads to use (default: one per core)" << endl;
+  cerr << "    --seed <n>         random seed for choosing samples (default 0)" << endl;
+  cerr << "    --top <k>          number of actors to rank (default " << kDefaultTopCount << ")" << endl;
+}
+
+/**
+ * The distance file is a header identifying the data files and the center,
+ * then one distance byte per actor, in sorted name order, with 255 for
+ * actors the center can't reach.  Everything is in native byte order.
+ */
+
+struct distanceFileHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  int actorCount;
+  int center;
+};
+
+static const int kDistanceFileMagic = 0x4e434142;  // "BACN"
+static const int kDistanceFileVersion = 1;
+
+static bool writeDistances(const graph& g, const bfsTree& tree, const string& fileName)
+{
+  const imdb& db = g.getDatabase();
+  distanceFileHeader header;
+  header.magic = kDistanceFileMagic;
+  header.version = kDistanceFileVersion;
+  header.actorFileSize = db.getActorFileSize();
+  header.movieFileSize = db.getMovieFileSize();
+  header.actorCount = g.getActorCount();
+  header.center = tree.source;
+
+  ofstream outfile(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  outfile.write((const char *) &header, sizeof(header));
+  if (!tree.distance.empty())
+    outfile.write((const char *) &tree.distance[0], tree.distance.size());
+  outfile.close();
+  return !outfile.fail();
+}
+
+/**
+ * Function: printHistogram
+ * ------------------------
+ * Prints one tab-separated line per distance with the number of actors at
+ * that distance, then a line for the unreachable actors, and reports the
+ * average distance over the reachable ones on cerr.
+ */
+
+static void printHistogram(const bfsTree& tree)
+{
+  vector<int> counts(kUnreachable + 1, 0);
+  for (int actor = 0; actor < (int) tree.distance.size(); actor++)
+    counts[tree.distance[actor]]++;
+
+  int reached = 0;
+  long long total = 0;
+  cout << "distance\tactors" << endl;
+  for (int d = 0; d < kUnreachable; d++) {
+    if (counts[d] == 0) continue;
+    cout << d << "\t" << counts[d] << endl;
+    reached += counts[d];
+    total += (long long) d * counts[d];
+  }
+  cout << "inf\t" << counts[kUnreachable] << endl;
+  cerr << fixed << setprecision(3) << "Average distance " << (reached > 0 ? (double) total / reached : 0)
+       << " over " << reached << " reachable actors." << endl;
+}
+
+/**
+ * Type: centralityState
+ * ---------------------
+ * What the centrality workers share: the graph and the sampled sources,
+ * handed out one at a time through an atomic cursor.  Each worker sums
+ * distances into its own arrays, so the searches never contend.
+ */
+
+struct centralityState {
+  const graph *g;
+  const vector<int> *sources;
+  int cursor;
+};
+
+struct centralityWorker {
+  centralityState *state;
+  vector<long long> totals;   // sum of distances from the sources that reached each actor
+  vector<int> reached;        // number of sources that reached each actor
+  pthread_t thread;
+};
+
+static void *sampleDistances(void *arg)
+{
+  centralityWorker *worker = (centralityWorker *) arg;
+  const graph& g = *worker->state->g;
+  int count = worker->state->sources->size();
+  worker->totals.assign(g.getActorCount(), 0);
+  worker->reached.assign(g.getActorCount(), 0);
+
+  bfsTree tree;
+  while (true) {
+    int next = __sync_fetch_and_add(&worker->state->cursor, 1);
+    if (next >= count) break;
+    breadthFirstSearch(g, (*worker->state->sources)[next], tree, false, 1);
+    for (int actor = 0; actor < g.getActorCount(); actor++) {
+      if (tree.distance[actor] == kUnreachable) continue;
+      worker->totals[actor] += tree.distance[actor];
+      worker->reached[actor]++;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Orders actors by increasing average distance, breaking ties by id.
+ */
+
+struct byAverage {
+  const vector<double>& average;
+  byAverage(const vector<double>& average) : average(average) {}
+  bool operator()(int first, int second) const {
+    return average[first] != average[second] ? average[first] < average[second] : first < second;
+  }
+};
+
+/**
+ * Function: rankByCentrality
+ * --------------------------
+ * Searches from sampleCount actors chosen at random (among those with at
+ * least one credit), one search per thread at a time, and estimates each
+ * actor's average distance to everyone else as its average distance from
+ * the samples that reached it.  Only actors reached by the most samples,
+ * which in practice means those in the largest component, are ranked,
+ * since averages within a small component aren't comparable.
+ */
+
+static void rankByCentrality(const graph& g, int sampleCount, unsigned int seed, int topCount,
+                             int numThreads)
+{
+  vector<int> sources;
+  for (int actor = 0; actor < g.getActorCount(); actor++)
+    if (g.getCreditCount(actor) > 0) sources.push_back(actor);
+  sampleCount = min(sampleCount, (int) sources.size());
+  for (int i = 0; i < sampleCount; i++)
+    swap(sources[i], sources[i + rand_r(&seed) % (sources.size() - i)]);
+  sources.resize(sampleCount);
+
+  numThreads = max(1, min(numThreads, sampleCount));
+  centralityState state = { &g, &sources, 0 };
+  vector<centralityWorker> workers(numThreads);
+  for (int i = 0; i < numThreads; i++) workers[i].state = &state;
+  vector<bool> started(numThreads, false);
+  for (int i = 1; i < numThreads; i++)
+    started[i] = pthread_create(&workers[i].thread, NULL, sampleDistances, &workers[i]) == 0;
+  sampleDistances(&workers[0]);
+  for (int i = 1; i < numThreads; i++)
+    if (started[i]) pthread_join(workers[i].thread, NULL);
+
+  vector<long long> totals(g.getActorCount(), 0);
+  vector<int> reached(g.getActorCount(), 0);
+  for (int i = 0; i < numThreads; i++) {
+    if (workers[i].totals.empty()) continue;   // never started
+    for (int actor = 0; actor < g.getActorCount(); actor++) {
+      totals[actor] += workers[i].totals[actor];
+      reached[actor] += workers[i].reached[actor];
+    }
+  }
+
+  int mostReached = 0;
+  for (int actor = 0; actor < g.getActorCount(); actor++) mostReached = max(mostReached, reached[actor]);
+  vector<double> average(g.getActorCount(), 0);
+  vector<int> ranked;
+  for (int actor = 0; actor < g.getActorCount(); actor++) {
+    if (mostReached == 0 || reached[actor] != mostReached) continue;
+    average[actor] = (double) totals[actor] / reached[actor];
+    ranked.push_back(actor);
+  }
+  topCount = min(topCount, (int) ranked.size());
+  partial_sort(ranked.begin(), ranked.begin() + topCount, ranked.end(), byAverage(average));
+
+  cout << "rank\taverage\tactor" << endl;
+  cout << fixed << setprecision(4);
+  for (int i = 0; i < topCount; i++)
+    cout << i + 1 << "\t" << average[ranked[i]] << "\t" << g.getActorName(ranked[i]) << endl;
+  cerr << "Ranked " << ranked.size() << " actors from " << sampleCount << " samples on "
+       << numThreads << " threads." << endl;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Opens the imdb in the usual data directory, builds the graph, and runs
+ * whichever computation the command line asks for.
+ */
+
+int main(int argc, const char *argv[])
+{
+  const char *center = NULL;
+  const char *outFile = NULL;
+  int sampleCount = 0;
+  int numThreads = 0;
+  unsigned int seed = 0;
+  int topCount = kDefaultTopCount;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) outFile = argv[++i];
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numThreads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) topCount = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--centrality") == 0 && i + 1 < argc) sampleCount = atoi(argv[++i]);
+    else if (argv[i][0] != '-' && center == NULL) center = argv[i];
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if ((center == NULL) == (sampleCount <= 0)) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (numThreads <= 0) numThreads = getDefaultThreadCount();
+
+  imdb db(determinePathToData());
+  if (!db.good()) {
+    cerr << "Data directory not found!  Aborting..." << endl;
+    return 1;
+  }
+  graph g(db);
+
+  if (sampleCount > 0) {
+    rankByCentrality(g, sampleCount, seed, topCount, numThreads);
+    return 0;
+  }
+
+  int source = g.getActorId(center);
+  if (source == -1) {
+    cerr << "We couldn't find \"" << center << "\" in the movie database." << endl;
+    return 1;
+  }
+  bfsTree tree;
+  breadthFirstSearch(g, source, tree, false, numThreads);
+  printHistogram(tree);
+  if (outFile != NULL && !writeDistances(g, tree, outFile)) {
+    cerr << "Couldn't write the distances to \"" << outFile << "\"." << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include "bfs-cache.h"
+#include <fstream>
+using namespace std;
+
+static const int kMaxTrackedSources = 1 << 16;  // hit counts are forgotten past this many
+
+/**
+ * The cache file is a header identifying the graph, then each tree in turn:
+ * its source, then its distance, parent and via arrays.  Everything is in
+ * native byte order.  As with the landmark file, the header records the
+ * data file sizes and the graph's numbering, not just its counts.
+ */
+
+struct cacheFileHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  unsigned int numbering;
+  int actorCount;
+  int movieCount;
+  int edgeCount;
+  int entryCount;
+};
+
+static const int kCacheFileMagic = 0x43534642;  // "BFSC"
+static const int kCacheFileVersion = 2;
+
+bfsCache::bfsCache(const graph& g, size_t memoryBudget, int minHits, int numThreads) :
+  g(g), memoryBudget(memoryBudget), minHits(minHits), numThreads(numThreads), memoryUsed(0)
+{
+  pthread_mutex_init(&lock, NULL);
+}
+
+bfsCache::~bfsCache()
+{
+  pthread_mutex_destroy(&lock);
+}
+
+size_t bfsCache::getTreeSize() const
+{
+  return (size_t) g.getActorCount() * (sizeof(unsigned char) + 2 * sizeof(int));
+}
+
+// looks up a cached tree and marks it most recently used; caller holds the lock
+const bfsTree *bfsCache::find(int source)
+{
+  map<int, list<cacheEntry>::iterator>::iterator found = bySource.find(source);
+  if (found == bySource.end()) return NULL;
+  entries.splice(entries.begin(), entries, found->second);
+  return &found->second->tree;
+}
+
+// adopts the tree's arrays, evicting old trees to make room; caller holds the lock
+void bfsCache::insert(bfsTree& tree)
+{
+  if (getTreeSize() > memoryBudget || bySource.count(tree.source) > 0) return;
+  while (memoryUsed + getTreeSize() > memoryBudget) {
+    bySource.erase(entries.back().tree.source);
+    entries.pop_back();
+    memoryUsed -= getTreeSize();
+  }
+  entries.push_front(cacheEntry());
+  entries.front().tree.source = tree.source;
+  entries.front().tree.distance.swap(tree.distance);
+  entries.front().tree.parent.swap(tree.parent);
+  entries.front().tree.via.swap(tree.via);
+  bySource[tree.source] = entries.begin();
+  memoryUsed += getTreeSize();
+  hits.erase(tree.source);
+}
+
+path bfsCache::buildPath(const bfsTree& tree, int actor) const
+{
+  vector<int> chain;
+  for (int cur = actor; cur != tree.source; cur = tree.parent[cur]) chain.push_back(cur);
+  path result(g.getActorName(tree.source));
+  for (int i = (int) chain.size() - 1; i >= 0; i--)
+    result.addConnection(g.getMovie(tree.via[chain[i]]), g.getActorName(chain[i]));
+  return result;
+}
+
+bool bfsCache::findShortestPath(const string& source, const string& target, path& result, bool& found,
+                                int maxDegrees)
+{
+  int from = g.getActorId(source);
+  int to = g.getActorId(target);
+  if (from == -1 || to == -1) return false;
+
+  pthread_mutex_lock(&lock);
+  const bfsTree *tree = find(from);
+  bool reversed = false;
+  if (tree == NULL && (tree = find(to)) != NULL) reversed = true;
+  if (tree == NULL) {
+    if ((int) hits.size() >= kMaxTrackedSources) hits.clear();
+    bool popular = ++hits[from] >= minHits;
+    pthread_mutex_unlock(&lock);
+    if (!popular) return false;
+
+    // search without the lock held; a racing thread may cache the same source
+    bfsTree computed;
+    breadthFirstSearch(g, from, computed, true, numThreads);
+    pthread_mutex_lock(&lock);
+    insert(computed);
+    tree = find(from);
+    if (tree == NULL) {                   // too big for the budget, answer from our copy
+      pthread_mutex_unlock(&lock);
+      found = computed.distance[to] != kUnreachable && computed.distance[to] <= maxDegrees;
+      if (found) result = buildPath(computed, to);
+      return true;
+    }
+  }
+
+  int end = reversed ? from : to;
+  found = tree->distance[end] != kUnreachable && tree->distance[end] <= maxDegrees;
+  if (found) {
+    result = buildPath(*tree, end);
+    if (reversed) result.reverse();
+  }
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+bool bfsCache::load(const string& fileName)
+{
+  ifstream infile(fileName.c_str(), ios::in | ios::binary);
+  cacheFileHeader header;
+  if (!infile.read((char *) &header, sizeof(header))) return false;
+  if (header.magic != kCacheFileMagic || header.version != kCacheFileVersion ||
+      header.actorFileSize != (long long) g.getDatabase().getActorFileSize() ||
+      header.movieFileSize != (long long) g.getDatabase().getMovieFileSize() ||
+      header.numbering != g.getNumbering() ||
+      header.actorCount != g.getActorCount() || header.movieCount != g.getMovieCount() ||
+      header.edgeCount != g.getEdgeCount()) return false;
+
+  int count = g.getActorCount();
+  vector<bfsTree> trees;
+  for (int i = 0; i < header.entryCount; i++) {
+    bfsTree tree;
+    tree.distance.resize(count);
+    tree.parent.resize(count);
+    tree.via.resize(count);
+    infile.read((char *) &tree.source, sizeof(int));
+    infile.read((char *) &tree.distance[0], count * sizeof(unsigned char));
+    infile.read((char *) &tree.parent[0], count * sizeof(int));
+    infile.read((char *) &tree.via[0], count * sizeof(int));
+    if (infile.fail() || tree.source < 0 || tree.source >= count) return false;
+    trees.push_back(bfsTree());
+    trees.back().source = tree.source;
+    trees.back().distance.swap(tree.distance);
+    trees.back().parent.swap(tree.parent);
+    trees.back().via.swap(tree.via);
+  }
+
+  // the file is most recently used first, so insert from the back
+  pthread_mutex_lock(&lock);
+  for (int i = (int) trees.size() - 1; i >= 0; i--) insert(trees[i]);
+  pthread_mutex_unlock(&lock);
+  return true;
+}
+
+bool bfsCache::save(const string& fileName) const
+{
+  pthread_mutex_lock(&lock);
+  cacheFileHeader header;
+  header.magic = kCacheFileMagic;
+  header.version = kCacheFileVersion;
+  header.actorFileSize = g.getDatabase().getActorFileSize();
+  header.movieFileSize = g.getDatabase().getMovieFileSize();
+  header.numbering = g.getNumbering();
+  header.actorCount = g.getActorCount();
+  header.movieCount = g.getMovieCount();
+  header.edgeCount = g.getEdgeCount();
+  header.entryCount = entries.size();
+
+  int count = g.getActorCount();
+  ofstream outfile(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  outfile.write((const char *) &header, sizeof(header));
+  for (list<cacheEntry>::const_iterator curr = entries.begin(); curr != entries.end(); ++curr) {
+    const bfsTree& tree = curr->tree;
+    outfile.write((const char *) &tree.source, sizeof(int));
+    outfile.write((const char *) &tree.distance[0], count * sizeof(unsigned char));
+    outfile.write((const char *) &tree.parent[0], count * sizeof(int));
+    outfile.write((const char *) &tree.via[0], count * sizeof(int));
+  }
+  pthread_mutex_unlock(&lock);
+  outfile.close();
+  return !outfile.fail();
+}
+
+int bfsCache::getEntryCount() const
+{
+  pthread_mutex_lock(&lock);
+  int count = entries.size();
+  pthread_mutex_unlock(&lock);
+  return count;
+}
+
+size_t bfsCache::getMemoryUsed() const
+{
+  pthread_mutex_lock(&lock);
+  size_t used = memoryUsed;
+  pthread_mutex_unlock(&lock);
+  return used;
+}
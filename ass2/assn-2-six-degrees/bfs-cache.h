@@ -0,0 +1,112 @@
+#ifndef __bfs_cache__
+#define __bfs_cache__
+
+#include "bfs.h"
+#include "path.h"
+#include "search.h"
+#include <list>
+#include <map>
+#include <string>
+#include <pthread.h>
+using namespace std;
+
+/**
+ * Class: bfsCache
+ * ---------------
+ * Keeps complete single-source search results (distance, parent and via
+ * arrays; see bfsTree) for the actors that queries keep starting from, so
+ * any query touching one of them is answered by walking parent pointers
+ * instead of searching.  Paths are undirected, so a cached tree answers
+ * queries that start or end at its source.
+ *
+ * A source's tree is computed once it has been seen minHits times, and
+ * trees are evicted least recently used first once the cache outgrows
+ * its memory budget.  Every method is safe to call from several threads.
+ */
+
+class bfsCache {
+
+ public:
+
+  /**
+   * Constructor: bfsCache
+   * ---------------------
+   * Constructs an empty cache over the specified graph.
+   *
+   * @param g the graph searched to fill the cache; it must outlive the cache.
+   * @param memoryBudget the most memory, in bytes, the cached trees may use.
+   * @param minHits how many times a source must be seen before it's cached.
+   * @param numThreads the number of threads each search may use.
+   */
+
+  bfsCache(const graph& g, size_t memoryBudget, int minHits = 2, int numThreads = 1);
+  ~bfsCache();
+
+  /**
+   * Method: findShortestPath
+   * ------------------------
+   * Answers the query from the cache if either actor's tree is cached, or
+   * if this query makes the source popular enough to cache.  Answers agree
+   * with the uncached findShortestPath, including its maxDegrees limit.
+   *
+   * @param source the name of the actor the path starts with.
+   * @param target the name of the actor the path ends with.
+   * @param result updated with the path, if one is found.
+   * @param found updated with whether a path was found.
+   * @param maxDegrees the longest path worth reporting, in movies.
+   * @return true if and only if the cache answered the query; if false,
+   *         result and found are left alone and the caller should search.
+   */
+
+  bool findShortestPath(const string& source, const string& target, path& result, bool& found,
+                        int maxDegrees = kMaxDegrees);
+
+  /**
+   * Methods: load
+   *          save
+   * --------------
+   * Read and write the cached trees, most recently used first, so a cache
+   * can be carried over between runs.  load ignores files written for a
+   * different graph and only adds entries that fit in the budget.
+   *
+   * @return true if and only if the file was read or written in full.
+   */
+
+  bool load(const string& fileName);
+  bool save(const string& fileName) const;
+
+  /**
+   * Methods: getEntryCount
+   *          getMemoryUsed
+   * -----------------------
+   * Report how many trees are cached and how many bytes they occupy.
+   */
+
+  int getEntryCount() const;
+  size_t getMemoryUsed() const;
+
+ private:
+  struct cacheEntry {
+    bfsTree tree;
+  };
+
+  const graph& g;
+  size_t memoryBudget;
+  int minHits;
+  int numThreads;
+  size_t memoryUsed;
+  list<cacheEntry> entries;                       // most recently used first
+  map<int, list<cacheEntry>::iterator> bySource;
+  map<int, int> hits;                             // sightings of uncached sources
+  mutable pthread_mutex_t lock;
+
+  size_t getTreeSize() const;
+  const bfsTree *find(int source);
+  void insert(bfsTree& tree);
+  path buildPath(const bfsTree& tree, int actor) const;
+
+  bfsCache(const bfsCache& original);
+  bfsCache& operator=(const bfsCache& rhs);
+};
+
+#endif
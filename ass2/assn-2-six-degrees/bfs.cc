@@ -0,0 +1,235 @@
+#include "bfs.h"
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
+using namespace std;
+
+static const int kActors = 0;
+static const int kMovies = 1;
+static const int kChunkSize = 256;           // nodes per unit of work; a multiple of 64
+static const int kParallelThreshold = 4096;  // frontier edges below which a level runs inline
+static const int kAlpha = 14;                // top-down/bottom-up switching parameters,
+static const int kBeta = 24;                 // as suggested by Beamer et al.
+
+typedef unsigned long long bitmapWord;
+
+/**
+ * Type: bfsState
+ * --------------
+ * Everything the threads expanding one level share.  The frontier always
+ * holds nodes from a single side of the graph (all actors or all movies),
+ * and each level discovers nodes on the other side.
+ */
+
+struct bfsState {
+  const graph *g;
+  vector<bitmapWord> visited[2];
+  vector<bitmapWord> frontierBits;  // the frontier as a bitmap, for bottom-up levels
+  vector<int> frontier;
+  int side;
+  bool bottomUp;
+  int cursor;                       // next unit of work, claimed atomically
+  unsigned char level;              // distance given to actors discovered this level
+  unsigned char *distance;
+  int *actorVia;                    // NULL unless parents were requested
+  int *movieParent;
+};
+
+struct bfsWorker {
+  bfsState *state;
+  vector<int> next;
+  pthread_t thread;
+};
+
+static inline const int *neighborsBegin(const graph *g, int side, int node)
+{
+  return side == kActors ? g->creditsBegin(node) : g->castBegin(node);
+}
+
+static inline const int *neighborsEnd(const graph *g, int side, int node)
+{
+  return side == kActors ? g->creditsEnd(node) : g->castEnd(node);
+}
+
+static inline bool testBit(const bitmapWord *bits, int node)
+{
+  return (bits[node >> 6] >> (node & 63)) & 1;
+}
+
+// plain read first, so already-visited nodes never cost an atomic
+static inline bool claimBit(bitmapWord *bits, int node)
+{
+  bitmapWord mask = (bitmapWord) 1 << (node & 63);
+  if (bits[node >> 6] & mask) return false;
+  return (__sync_fetch_and_or(&bits[node >> 6], mask) & mask) == 0;
+}
+
+static inline void discover(bfsState *s, int side, int node, int from)
+{
+  if (side == kActors) {
+    s->distance[node] = s->level;
+    if (s->actorVia != NULL) s->actorVia[node] = from;
+  } else if (s->movieParent != NULL) {
+    s->movieParent[node] = from;
+  }
+}
+
+static void expandTopDown(bfsWorker *w)
+{
+  bfsState *s = w->state;
+  int target = 1 - s->side;
+  bitmapWord *visited = &s->visited[target][0];
+  int size = s->frontier.size();
+  while (true) {
+    int begin = __sync_fetch_and_add(&s->cursor, kChunkSize);
+    if (begin >= size) break;
+    int end = min(begin + kChunkSize, size);
+    for (int i = begin; i < end; i++) {
+      int node = s->frontier[i];
+      const int *last = neighborsEnd(s->g, s->side, node);
+      for (const int *n = neighborsBegin(s->g, s->side, node); n != last; n++) {
+        if (!claimBit(visited, *n)) continue;
+        w->next.push_back(*n);
+        discover(s, target, *n, node);
+      }
+    }
+  }
+}
+
+// chunks are 64-aligned, so each visited word is only ever written by one thread
+static void expandBottomUp(bfsWorker *w)
+{
+  bfsState *s = w->state;
+  int target = 1 - s->side;
+  int count = target == kActors ? s->g->getActorCount() : s->g->getMovieCount();
+  bitmapWord *visited = &s->visited[target][0];
+  const bitmapWord *frontier = &s->frontierBits[0];
+  while (true) {
+    int begin = __sync_fetch_and_add(&s->cursor, kChunkSize);
+    if (begin >= count) break;
+    int end = min(begin + kChunkSize, count);
+    for (int node = begin; node < end; node++) {
+      if (testBit(visited, node)) continue;
+      const int *last = neighborsEnd(s->g, target, node);
+      for (const int *n = neighborsBegin(s->g, target, node); n != last; n++) {
+        if (!testBit(frontier, *n)) continue;
+        visited[node >> 6] |= (bitmapWord) 1 << (node & 63);
+        w->next.push_back(node);
+        discover(s, target, node, *n);
+        break;
+      }
+    }
+  }
+}
+
+static void *runWorker(void *arg)
+{
+  bfsWorker *w = (bfsWorker *) arg;
+  if (w->state->bottomUp) expandBottomUp(w); else expandTopDown(w);
+  return NULL;
+}
+
+/**
+ * Expands one level with the first worker on the calling thread and the
+ * rest on their own threads, then gathers their buffers into the next
+ * frontier.  Work is handed out in chunks, so a thread that fails to
+ * start simply leaves its share to the others.
+ */
+
+static void expandLevel(bfsState& s, vector<bfsWorker>& workers, int numThreads)
+{
+  s.cursor = 0;
+  vector<bool> started(numThreads, false);
+  for (int i = 0; i < numThreads; i++) workers[i].next.clear();
+  for (int i = 1; i < numThreads; i++)
+    started[i] = pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) == 0;
+  runWorker(&workers[0]);
+  for (int i = 1; i < numThreads; i++)
+    if (started[i]) pthread_join(workers[i].thread, NULL);
+
+  s.frontier.clear();
+  for (int i = 0; i < numThreads; i++)
+    s.frontier.insert(s.frontier.end(), workers[i].next.begin(), workers[i].next.end());
+}
+
+static long long getDegreeSum(const graph& g, int side, const vector<int>& nodes)
+{
+  long long sum = 0;
+  for (int i = 0; i < (int) nodes.size(); i++)
+    sum += side == kActors ? g.getCreditCount(nodes[i]) : g.getCastCount(nodes[i]);
+  return sum;
+}
+
+int getDefaultThreadCount()
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (int) count : 1;
+}
+
+void breadthFirstSearch(const graph& g, int source, bfsTree& tree,
+                        bool withParents, int numThreads)
+{
+  if (numThreads <= 0) numThreads = getDefaultThreadCount();
+  int counts[2] = { g.getActorCount(), g.getMovieCount() };
+  vector<int> movieParent;
+
+  tree.source = source;
+  tree.distance.assign(counts[kActors], kUnreachable);
+  tree.distance[source] = 0;
+  tree.parent.clear();
+  tree.via.clear();
+  if (withParents) {
+    tree.via.assign(counts[kActors], -1);
+    movieParent.assign(counts[kMovies], -1);
+  }
+
+  bfsState s;
+  s.g = &g;
+  for (int side = 0; side < 2; side++) s.visited[side].assign(counts[side] / 64 + 1, 0);
+  s.visited[kActors][source >> 6] |= (bitmapWord) 1 << (source & 63);
+  s.frontier.push_back(source);
+  s.side = kActors;
+  s.bottomUp = false;
+  s.level = 0;
+  s.distance = &tree.distance[0];
+  s.actorVia = withParents ? &tree.via[0] : NULL;
+  s.movieParent = withParents && counts[kMovies] > 0 ? &movieParent[0] : NULL;
+
+  vector<bfsWorker> workers(numThreads);
+  for (int i = 0; i < numThreads; i++) workers[i].state = &s;
+
+  long long unexploredEdges[2] = { g.getEdgeCount(), g.getEdgeCount() };
+  long long frontierEdges = getDegreeSum(g, kActors, s.frontier);
+  unexploredEdges[kActors] -= frontierEdges;
+
+  while (!s.frontier.empty()) {
+    int target = 1 - s.side;
+    if (target == kActors && s.level == kUnreachable - 1) break;
+    if (!s.bottomUp) {
+      s.bottomUp = frontierEdges > unexploredEdges[target] / kAlpha;
+    } else {
+      s.bottomUp = (long long) s.frontier.size() * kBeta > counts[s.side];
+    }
+
+    if (s.bottomUp) {
+      s.frontierBits.assign(counts[s.side] / 64 + 1, 0);
+      for (int i = 0; i < (int) s.frontier.size(); i++)
+        s.frontierBits[s.frontier[i] >> 6] |= (bitmapWord) 1 << (s.frontier[i] & 63);
+    }
+    if (target == kActors) s.level++;
+
+    bool parallel = s.bottomUp || frontierEdges >= kParallelThreshold;
+    expandLevel(s, workers, parallel ? numThreads : 1);
+
+    s.side = target;
+    frontierEdges = getDegreeSum(g, s.side, s.frontier);
+    unexploredEdges[s.side] -= frontierEdges;
+  }
+
+  if (withParents) {
+    tree.parent.assign(counts[kActors], -1);
+    tree.parent[source] = source;
+    for (int actor = 0; actor < counts[kActors]; actor++)
+      if (tree.via[actor] != -1) tree.parent[actor] = movieParent[tree.via[actor]];
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef __bfs__
+#define __bfs__
+
+#include "graph.h"
+#include <vector>
+using namespace std;
+
+/**
+ * Constant: kUnreachable
+ * ----------------------
+ * Distance recorded for actors that can't be reached from the source.
+ */
+
+static const unsigned char kUnreachable = 255;
+
+/**
+ * Convenience struct: bfsTree
+ * ---------------------------
+ * The result of a single-source breadth-first search over a graph.
+ * Distances count movies, so the source is at distance 0 and its
+ * costars are at distance 1.  The parent and via arrays are filled
+ * only on request: together they record, for each reached actor, the
+ * actor it was discovered from and the movie the two share.  The source
+ * is its own parent, and via is -1 for the source and unreached actors.
+ */
+
+struct bfsTree {
+  int source;
+  vector<unsigned char> distance;
+  vector<int> parent;
+  vector<int> via;
+};
+
+/**
+ * Function: breadthFirstSearch
+ * ----------------------------
+ * Computes the distance from the source actor to every other actor,
+ * level by level, using several threads.  Each level either expands the
+ * frontier top-down, claiming unvisited neighbors in shared atomic
+ * bitmaps, or, once the frontier's edges outnumber the unexplored ones,
+ * bottom-up, where every unvisited node looks for any neighbor in the
+ * frontier and stops at the first.  Threads collect the next frontier in
+ * their own buffers, which are concatenated between levels.
+ *
+ * @param g the graph to search.
+ * @param source the id of the source actor.
+ * @param tree updated with the results; its arrays are resized to fit.
+ * @param withParents true if the parent and via arrays should be filled.
+ * @param numThreads the number of threads to use, or 0 for one per core.
+ */
+
+void breadthFirstSearch(const graph& g, int source, bfsTree& tree,
+                        bool withParents = false, int numThreads = 0);
+
+/**
+ * Function: getDefaultThreadCount
+ * -------------------------------
+ * Returns the number of online processors, which is how many threads the
+ * graph algorithms use when the caller asks for 0.
+ */
+
+int getDefaultThreadCount();
+
+#endif
@@ -0,0 +1,143 @@
+#include "component-index.h"
+#include <algorithm>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+using namespace std;
+
+const char *const componentIndex::kFileName = "components";
+
+/**
+ * The component file is a header identifying the data files, then one
+ * int label per actor, then one int size per component.  Everything is
+ * in native byte order.
+ */
+
+struct componentFileHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  int actorCount;
+  int componentCount;
+};
+
+static const int kComponentFileMagic = 0x504d4f43;  // "COMP"
+static const int kComponentFileVersion = 1;
+
+static int findRoot(vector<int>& parent, int node)
+{
+  while (parent[node] != node) {
+    parent[node] = parent[parent[node]];    // path halving
+    node = parent[node];
+  }
+  return node;
+}
+
+static void join(vector<int>& parent, vector<int>& size, int first, int second)
+{
+  first = findRoot(parent, first);
+  second = findRoot(parent, second);
+  if (first == second) return;
+  if (size[first] < size[second]) swap(first, second);
+  parent[second] = first;
+  size[first] += size[second];
+}
+
+/**
+ * Orders component roots by decreasing size, breaking ties by root so the
+ * numbering is deterministic.
+ */
+
+struct bySize {
+  const vector<int>& size;
+  bySize(const vector<int>& size) : size(size) {}
+  bool operator()(int first, int second) const {
+    return size[first] != size[second] ? size[first] > size[second] : first < second;
+  }
+};
+
+bool componentIndex::build(const graph& g, const string& fileName)
+{
+  int actorCount = g.getActorCount();
+  vector<int> parent(actorCount), size(actorCount, 1);
+  for (int actor = 0; actor < actorCount; actor++) parent[actor] = actor;
+  for (int movie = 0; movie < g.getMovieCount(); movie++)
+    for (const int *actor = g.castBegin(movie) + 1; actor < g.castEnd(movie); actor++)
+      join(parent, size, *g.castBegin(movie), *actor);
+
+  vector<int> roots;
+  for (int actor = 0; actor < actorCount; actor++)
+    if (findRoot(parent, actor) == actor) roots.push_back(actor);
+  sort(roots.begin(), roots.end(), bySize(size));
+
+  vector<int> componentOf(actorCount), sizes(roots.size()), labels(actorCount);
+  for (int i = 0; i < (int) roots.size(); i++) {
+    componentOf[roots[i]] = i;
+    sizes[i] = size[roots[i]];
+  }
+  // labels are looked up by name, so they're stored in name order, which
+  // graph ids don't follow in a renumbered compact file
+  const imdb& db = g.getDatabase();
+  for (int index = 0; index < actorCount; index++)
+    labels[index] = componentOf[findRoot(parent, g.getActorId(db.getActorRecord(index)))];
+
+  componentFileHeader header;
+  header.magic = kComponentFileMagic;
+  header.version = kComponentFileVersion;
+  header.actorFileSize = db.getActorFileSize();
+  header.movieFileSize = db.getMovieFileSize();
+  header.actorCount = actorCount;
+  header.componentCount = roots.size();
+
+  ofstream outfile(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  outfile.write((const char *) &header, sizeof(header));
+  if (actorCount > 0) {
+    outfile.write((const char *) &labels[0], labels.size() * sizeof(int));
+    outfile.write((const char *) &sizes[0], sizes.size() * sizeof(int));
+  }
+  outfile.close();
+  return !outfile.fail();
+}
+
+componentIndex::componentIndex(const imdb& db, const string& fileName) :
+  db(db), componentCount(0), labels(NULL), sizes(NULL), fd(-1), fileSize(0), fileMap(NULL)
+{
+  struct stat stats;
+  fd = open(fileName.c_str(), O_RDONLY);
+  if (fd == -1) return;
+  if (fstat(fd, &stats) != 0 || stats.st_size < (off_t) sizeof(componentFileHeader)) return;
+  fileSize = stats.st_size;
+  void *map = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) return;
+  fileMap = map;
+
+  const componentFileHeader *header = (const componentFileHeader *) fileMap;
+  if (header->magic != kComponentFileMagic || header->version != kComponentFileVersion ||
+      header->actorFileSize != (long long) db.getActorFileSize() ||
+      header->movieFileSize != (long long) db.getMovieFileSize() ||
+      header->actorCount != db.getActorCount() ||
+      fileSize != sizeof(componentFileHeader) +
+                  ((size_t) header->actorCount + header->componentCount) * sizeof(int)) return;
+
+  componentCount = header->componentCount;
+  labels = (const int *) (header + 1);
+  sizes = labels + header->actorCount;
+}
+
+componentIndex::~componentIndex()
+{
+  if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+  if (fd != -1) close(fd);
+}
+
+bool componentIndex::areConnected(const string& first, const string& second) const
+{
+  int firstIndex = db.findActorIndex(first.c_str());
+  int secondIndex = db.findActorIndex(second.c_str());
+  if (firstIndex == -1 || secondIndex == -1) return false;
+  return labels[firstIndex] == labels[secondIndex];
+}
@@ -0,0 +1,99 @@
+#ifndef __component_index__
+#define __component_index__
+
+#include "imdb.h"
+#include "graph.h"
+#include <string>
+using namespace std;
+
+/**
+ * Class: componentIndex
+ * ---------------------
+ * Labels every actor with the connected component of the actor/movie
+ * graph it belongs to, so that two actors with no path between them
+ * can be told apart in O(1) instead of by exhausting a search.  Component
+ * 0 is the largest, component 1 the next largest, and so on.
+ *
+ * The labels live in a sidecar file next to the data files (see build),
+ * indexed by actor position in sorted name order, and are mapped in
+ * read-only.
+ */
+
+class componentIndex {
+
+ public:
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name of the component file within a data directory.
+   */
+
+  static const char *const kFileName;
+
+  /**
+   * Static Method: build
+   * --------------------
+   * Computes the components with union-find over the movie casts and
+   * writes the labels to the specified file.
+   *
+   * @return true if and only if the file was written in full.
+   */
+
+  static bool build(const graph& g, const string& fileName);
+
+  /**
+   * Constructor: componentIndex
+   * ---------------------------
+   * Maps in the specified component file, which must have been built
+   * from the same data files as the specified imdb.
+   */
+
+  componentIndex(const imdb& db, const string& fileName);
+  ~componentIndex();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the file exists and was built from the
+   * imdb's data files.
+   */
+
+  bool good() const { return labels != NULL; }
+
+  /**
+   * Methods: getComponentCount
+   *          getComponent
+   *          getComponentSize
+   * --------------------------
+   * Report the number of components, the component an actor (by index in
+   * sorted name order) belongs to, and the number of actors in a component.
+   */
+
+  int getComponentCount() const { return componentCount; }
+  int getComponent(int actorIndex) const { return labels[actorIndex]; }
+  int getComponentSize(int component) const { return sizes[component]; }
+
+  /**
+   * Method: areConnected
+   * --------------------
+   * Returns true if and only if some path of movies joins the two named
+   * actors.  Unknown names are never connected.
+   */
+
+  bool areConnected(const string& first, const string& second) const;
+
+ private:
+  const imdb& db;
+  int componentCount;
+  const int *labels;
+  const int *sizes;
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  componentIndex(const componentIndex& original);
+  componentIndex& operator=(const componentIndex& rhs);
+};
+
+#endif
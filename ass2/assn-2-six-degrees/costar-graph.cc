@@ -0,0 +1,180 @@
+#include "costar-graph.h"
+#include "bfs.h"
+#include <algorithm>
+#include <string.h>
+#include <pthread.h>
+using namespace std;
+
+/**
+ * Type: projectionShard
+ * ---------------------
+ * A contiguous range of actors and the thread projecting it.  The first
+ * phase fills the shard's own arrays; the second copies them into the
+ * costar graph's, starting at base.
+ */
+
+struct projectionShard {
+  const graph *g;
+  int first;
+  int last;
+  vector<long long> counts;   // co-stars per actor in the shard
+  vector<int> costars;
+  vector<int> witnesses;
+  long long base;
+  int *costarsOut;
+  int *witnessesOut;
+  pthread_t thread;
+};
+
+static void *projectShard(void *arg)
+{
+  projectionShard *shard = (projectionShard *) arg;
+  const graph& g = *shard->g;
+  vector<int> seenBy(g.getActorCount(), -1);    // the last actor each co-star was found for
+  vector<pair<int, int> > found;
+  shard->counts.resize(shard->last - shard->first);
+  for (int actor = shard->first; actor < shard->last; actor++) {
+    found.clear();
+    for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++) {
+      for (const int *costar = g.castBegin(*movie); costar != g.castEnd(*movie); costar++) {
+        if (*costar == actor || seenBy[*costar] == actor) continue;
+        seenBy[*costar] = actor;
+        found.push_back(make_pair(*costar, *movie));   // credits ascend, so this is the lowest
+      }
+    }
+    sort(found.begin(), found.end());
+    shard->counts[actor - shard->first] = found.size();
+    for (int i = 0; i < (int) found.size(); i++) {
+      shard->costars.push_back(found[i].first);
+      shard->witnesses.push_back(found[i].second);
+    }
+  }
+  return NULL;
+}
+
+static void *copyShard(void *arg)
+{
+  projectionShard *shard = (projectionShard *) arg;
+  if (!shard->costars.empty()) {
+    memcpy(shard->costarsOut + shard->base, &shard->costars[0], shard->costars.size() * sizeof(int));
+    memcpy(shard->witnessesOut + shard->base, &shard->witnesses[0], shard->witnesses.size() * sizeof(int));
+  }
+  vector<int>().swap(shard->costars);
+  vector<int>().swap(shard->witnesses);
+  return NULL;
+}
+
+// runs fn on every shard, the first on the calling thread
+static void runShards(vector<projectionShard>& shards, void *(*fn)(void *))
+{
+  vector<bool> started(shards.size(), false);
+  for (int i = 1; i < (int) shards.size(); i++)
+    started[i] = pthread_create(&shards[i].thread, NULL, fn, &shards[i]) == 0;
+  for (int i = 0; i < (int) shards.size(); i++)
+    if (i == 0 || !started[i]) fn(&shards[i]);
+  for (int i = 1; i < (int) shards.size(); i++)
+    if (started[i]) pthread_join(shards[i].thread, NULL);
+}
+
+costarGraph::costarGraph(const graph& g, int numThreads) : g(g)
+{
+  if (numThreads <= 0) numThreads = getDefaultThreadCount();
+  int actorCount = g.getActorCount();
+
+  // shard boundaries split the cast entries to be scanned evenly
+  vector<long long> work(actorCount + 1, 0);
+  for (int actor = 0; actor < actorCount; actor++) {
+    work[actor + 1] = work[actor];
+    for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++)
+      work[actor + 1] += g.getCastCount(*movie);
+  }
+  numThreads = max(1, min(numThreads, actorCount));
+  vector<projectionShard> shards(numThreads);
+  for (int i = 0; i < numThreads; i++) {
+    shards[i].g = &g;
+    shards[i].first = i == 0 ? 0 : shards[i - 1].last;
+    long long goal = work[actorCount] / numThreads * (i + 1);
+    shards[i].last = i + 1 == numThreads ? actorCount :
+      lower_bound(work.begin() + shards[i].first, work.end() - 1, goal) - work.begin();
+  }
+  runShards(shards, projectShard);
+
+  start.resize(actorCount + 1);
+  start[0] = 0;
+  for (int i = 0; i < numThreads; i++) {
+    shards[i].base = start[shards[i].first];
+    for (int actor = shards[i].first; actor < shards[i].last; actor++)
+      start[actor + 1] = start[actor] + shards[i].counts[actor - shards[i].first];
+  }
+  costars.resize(start[actorCount]);
+  witnesses.resize(start[actorCount]);
+  for (int i = 0; i < numThreads; i++) {
+    shards[i].costarsOut = costars.empty() ? NULL : &costars[0];
+    shards[i].witnessesOut = witnesses.empty() ? NULL : &witnesses[0];
+  }
+  runShards(shards, copyShard);
+
+  costarList = costars.empty() ? NULL : &costars[0];
+  witnessList = witnesses.empty() ? NULL : &witnesses[0];
+}
+
+size_t costarGraph::getMemoryUsage() const
+{
+  return start.size() * sizeof(long long) + (costars.size() + witnesses.size()) * sizeof(int);
+}
+
+/**
+ * Plain level-by-level search: every co-star is one step away, so the
+ * first time the target turns up is along a shortest path.  Parents and
+ * witnesses are kept in arrays indexed by actor, since a search that
+ * skips the movie layer tends to reach a large share of the actors.
+ */
+
+bool findShortestPath(const costarGraph& costars, int source, int target, path& result,
+                      int maxDegrees, searchStats *stats)
+{
+  searchStats local;
+  if (stats == NULL) stats = &local;
+  stats->method = "costars";
+  const graph& g = costars.getGraph();
+  if (source == target) {
+    result = path(g.getActorName(source));
+    return true;
+  }
+
+  vector<int> parent(g.getActorCount(), -1), via(g.getActorCount(), -1);
+  parent[source] = source;
+  vector<int> frontier(1, source), next;
+  bool found = false;
+  for (int depth = 0; depth < maxDegrees && !frontier.empty() && !found; depth++) {
+    stats->startLevel(frontier.size());
+    next.clear();
+    for (int f = 0; f < (int) frontier.size() && !found; f++) {
+      stats->nodesExpanded++;
+      const int *witness = costars.witnessesBegin(frontier[f]);
+      for (const int *actor = costars.costarsBegin(frontier[f]);
+           actor != costars.costarsEnd(frontier[f]); actor++, witness++) {
+        stats->edgesScanned++;
+        if (parent[*actor] != -1) continue;
+        parent[*actor] = frontier[f];
+        via[*actor] = *witness;
+        if (*actor == target) {
+          found = true;
+          break;
+        }
+        next.push_back(*actor);
+      }
+    }
+    stats->endLevel();
+    frontier.swap(next);
+  }
+  stats->visitedBytes = (parent.capacity() + via.capacity()) * sizeof(int);
+  if (!found) return false;
+
+  vector<int> chain;
+  for (int cur = target; cur != source; cur = parent[cur]) chain.push_back(cur);
+  result = path(g.getActorName(source));
+  for (int i = (int) chain.size() - 1; i >= 0; i--)
+    result.addConnection(g.getMovie(via[chain[i]]), g.getActorName(chain[i]));
+  return true;
+}
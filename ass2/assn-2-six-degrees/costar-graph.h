@@ -0,0 +1,101 @@
+#ifndef __costar_graph__
+#define __costar_graph__
+
+#include "graph.h"
+#include "path.h"
+#include "search.h"
+#include <vector>
+using namespace std;
+
+/**
+ * Class: costarGraph
+ * ------------------
+ * The actor-to-actor projection of a graph: for every actor, the sorted,
+ * deduplicated ids of everyone who appeared in a movie with them, each
+ * paired with one witness movie the two share (the one with the lowest
+ * id).  It's stored in compressed sparse row form, like the graph, so a
+ * search takes one hop per degree instead of going through the movie
+ * layer, and never rescans the cast of a popular movie.
+ *
+ * The price is memory: an actor's co-stars typically outnumber their
+ * credits many times over, and every edge is stored from both ends.
+ * getMemoryUsage reports exactly what it costs, to weigh against the
+ * graph's own arrays.
+ */
+
+class costarGraph {
+
+ public:
+
+  /**
+   * Constructor: costarGraph
+   * ------------------------
+   * Builds the projection of the specified graph.  The actors are split
+   * into contiguous shards of about equal work (counted in cast entries
+   * scanned), one per thread; each thread projects its shard into its
+   * own arrays, and the shards are then copied into place in parallel.
+   *
+   * @param g the graph to project; it must outlive this object.
+   * @param numThreads the number of threads to use, or 0 for one per core.
+   */
+
+  costarGraph(const graph& g, int numThreads = 0);
+
+  /**
+   * Methods: getEdgeCount
+   *          getMemoryUsage
+   * -----------------------
+   * Return the number of (actor, co-star) pairs, which counts each edge
+   * once from either end, and the bytes the arrays occupy.
+   */
+
+  long long getEdgeCount() const { return costars.size(); }
+  size_t getMemoryUsage() const;
+
+  /**
+   * Methods: costarsBegin, costarsEnd
+   *          witnessesBegin
+   * -------------------------------
+   * Delimit an actor's co-star ids, in increasing order, and give the
+   * movie each was met through, in the same order.
+   */
+
+  const int *costarsBegin(int actor) const { return costarList + start[actor]; }
+  const int *costarsEnd(int actor) const { return costarList + start[actor + 1]; }
+  const int *witnessesBegin(int actor) const { return witnessList + start[actor]; }
+
+  /**
+   * Method: getGraph
+   * ----------------
+   * Returns the graph this is the projection of.
+   */
+
+  const graph& getGraph() const { return g; }
+
+ private:
+  const graph& g;
+  vector<long long> start;      // getActorCount() + 1 entries
+  vector<int> costars;
+  vector<int> witnesses;
+  const int *costarList;
+  const int *witnessList;
+
+  costarGraph(const costarGraph& original);
+  costarGraph& operator=(const costarGraph& rhs);
+};
+
+/**
+ * Function: findShortestPath
+ * --------------------------
+ * Breadth-first search from source to target over the co-star graph,
+ * giving up after maxDegrees movies.  It finds paths as short as the
+ * graph search does, with each movie being the witness for its step.
+ *
+ * @param stats if not NULL, updated with what the search cost.
+ * @return true if and only if a path was found.
+ */
+
+bool findShortestPath(const costarGraph& costars, int source, int target, path& result,
+                      int maxDegrees, searchStats *stats = NULL);
+
+#endif
@@ -0,0 +1,106 @@
+#include "graph.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * Puts the records, listed in the order the imdb enumerates them (sorted
+ * by name), in increasing order, which is how graph ids are assigned.  In
+ * the usual case they already are.
+ */
+
+static void sortRecords(vector<int>& records)
+{
+  for (int i = 1; i < (int) records.size(); i++) {
+    if (records[i - 1] < records[i]) continue;
+    sort(records.begin(), records.end());
+    return;
+  }
+}
+
+/**
+ * Translates a record into its id by binary searching the records, which
+ * are kept in increasing order.
+ */
+
+int graph::findRecord(const vector<int>& records, int record)
+{
+  vector<int>::const_iterator found = lower_bound(records.begin(), records.end(), record);
+  return found != records.end() && *found == record ? found - records.begin() : -1;
+}
+
+graph::graph(const imdb& db) : db(db)
+{
+  actorRecords.resize(db.getActorCount());
+  for (int i = 0; i < (int) actorRecords.size(); i++) actorRecords[i] = db.getActorRecord(i);
+  movieRecords.resize(db.getMovieCount());
+  for (int i = 0; i < (int) movieRecords.size(); i++) movieRecords[i] = db.getMovieRecord(i);
+  // the records in name order determine each name's id once they're sorted
+  numbering = 2166136261u;
+  for (int i = 0; i < (int) actorRecords.size(); i++) numbering = (numbering ^ actorRecords[i]) * 16777619u;
+  for (int i = 0; i < (int) movieRecords.size(); i++) numbering = (numbering ^ movieRecords[i]) * 16777619u;
+  sortRecords(actorRecords);
+  sortRecords(movieRecords);
+
+  castStart.resize(movieRecords.size() + 1);
+  for (int movie = 0; movie < (int) movieRecords.size(); movie++) {
+    castStart[movie] = cast.size();
+    recordList players = db.getCastRecords(movieRecords[movie]);
+    for (int record; players.next(record);) {
+      int actor = findRecord(actorRecords, record);
+      if (actor != -1) cast.push_back(actor);
+    }
+    sort(cast.begin() + castStart[movie], cast.end());
+  }
+  castStart[movieRecords.size()] = cast.size();
+
+  // credits are the transpose of the casts: count, prefix sum, then scatter
+  creditStart.assign(actorRecords.size() + 1, 0);
+  for (int i = 0; i < (int) cast.size(); i++) creditStart[cast[i] + 1]++;
+  for (int actor = 0; actor < (int) actorRecords.size(); actor++)
+    creditStart[actor + 1] += creditStart[actor];
+  credits.resize(cast.size());
+  vector<int> fill(creditStart.begin(), creditStart.end() - 1);
+  for (int movie = 0; movie < (int) movieRecords.size(); movie++)
+    for (int i = castStart[movie]; i < castStart[movie + 1]; i++)
+      credits[fill[cast[i]]++] = movie;
+
+  creditList = credits.empty() ? NULL : &credits[0];
+  castList = cast.empty() ? NULL : &cast[0];
+}
+
+int graph::getActorId(const string& player) const
+{
+  int record = db.findActor(player.c_str());
+  return record == -1 ? -1 : getActorId(record);
+}
+
+int graph::getActorId(int record) const
+{
+  return findRecord(actorRecords, record);
+}
+
+int graph::getMovieId(const film& movie) const
+{
+  int record = db.findMovie(movie.title.c_str(), movie.year);
+  return record == -1 ? -1 : getMovieId(record);
+}
+
+int graph::getMovieId(int record) const
+{
+  return findRecord(movieRecords, record);
+}
+
+film graph::getMovie(int movie) const
+{
+  film result;
+  result.title = db.getMovieTitle(movieRecords[movie]);
+  result.year = db.getMovieYear(movieRecords[movie]);
+  return result;
+}
+
+size_t graph::getMemoryUsage() const
+{
+  size_t ints = actorRecords.size() + movieRecords.size() + creditStart.size() + credits.size() +
+    castStart.size() + cast.size();
+  return ints * sizeof(int);
+}
@@ -0,0 +1,143 @@
+#ifndef __graph__
+#define __graph__
+
+#include "imdb.h"
+#include <vector>
+using namespace std;
+
+/**
+ * Class: graph
+ * ------------
+ * An in-memory, integer-keyed copy of the actor/movie graph stored in an
+ * imdb, laid out for whole-graph algorithms.  Actors and movies are given
+ * dense ids in the order of their records, which is their sorted order
+ * unless the imdb is a renumbered compact file (see imdb-convert), and
+ * each side's adjacency is stored in compressed sparse row form: one flat
+ * array of neighbor ids, plus an array of where each node's neighbors
+ * start.  Keeping the imdb's numbering keeps whatever locality the file
+ * was laid out with.
+ *
+ * Building a graph reads every cast list once.  The graph refers back to
+ * the imdb for names and titles, so the imdb must outlive it.
+ */
+
+class graph {
+
+ public:
+
+  /**
+   * Constructor: graph
+   * ------------------
+   * Builds the adjacency arrays for every actor and movie in the specified
+   * imdb.  The movie casts are taken as authoritative; each actor's credits
+   * are derived from them, so the two directions always agree.
+   *
+   * @param db the imdb to read; it must be good and outlive the graph.
+   */
+
+  graph(const imdb& db);
+
+  /**
+   * Methods: getActorCount
+   *          getMovieCount
+   *          getEdgeCount
+   * ----------------------
+   * Return the number of actors, movies and credits (actor/movie pairs)
+   * in the graph.  Actor ids run from 0 to getActorCount() - 1, and
+   * likewise for movies.
+   */
+
+  int getActorCount() const { return actorRecords.size(); }
+  int getMovieCount() const { return movieRecords.size(); }
+  int getEdgeCount() const { return credits.size(); }
+
+  /**
+   * Methods: creditsBegin, creditsEnd
+   *          castBegin, castEnd
+   * -------------------------------
+   * Delimit the movie ids an actor appeared in, or the actor ids in a
+   * movie's cast, both in increasing id order.
+   */
+
+  const int *creditsBegin(int actor) const { return creditList + creditStart[actor]; }
+  const int *creditsEnd(int actor) const { return creditList + creditStart[actor + 1]; }
+  const int *castBegin(int movie) const { return castList + castStart[movie]; }
+  const int *castEnd(int movie) const { return castList + castStart[movie + 1]; }
+  int getCreditCount(int actor) const { return creditStart[actor + 1] - creditStart[actor]; }
+  int getCastCount(int movie) const { return castStart[movie + 1] - castStart[movie]; }
+
+  /**
+   * Methods: getActorId
+   *          getMovieId
+   * --------------------
+   * Translate names, or imdb record offsets, into graph ids.
+   *
+   * @return the id, or -1 if there is no such actor or movie.
+   */
+
+  int getActorId(const string& player) const;
+  int getActorId(int record) const;
+  int getMovieId(const film& movie) const;
+  int getMovieId(int record) const;
+
+  /**
+   * Methods: getActorRecord
+   *          getMovieRecord
+   *          getActorName
+   *          getMovie
+   * ----------------------
+   * Translate graph ids back into imdb records, names and films.
+   */
+
+  int getActorRecord(int actor) const { return actorRecords[actor]; }
+  int getMovieRecord(int movie) const { return movieRecords[movie]; }
+  const char *getActorName(int actor) const { return db.getActorName(actorRecords[actor]); }
+  film getMovie(int movie) const;
+
+  /**
+   * Method: getDatabase
+   * -------------------
+   * Returns the imdb the graph was built from.
+   */
+
+  const imdb& getDatabase() const { return db; }
+
+  /**
+   * Method: getNumbering
+   * --------------------
+   * Returns a hash of which actor and movie every id stands for.  Files
+   * keyed by id record it along with the data file sizes, since
+   * renumbering the data (see imdb-convert) can change the ids without
+   * changing any count.
+   */
+
+  unsigned int getNumbering() const { return numbering; }
+
+  /**
+   * Method: getMemoryUsage
+   * ----------------------
+   * Returns the bytes the graph's arrays occupy.
+   */
+
+  size_t getMemoryUsage() const;
+
+ private:
+  const imdb& db;
+  vector<int> actorRecords;     // id -> record offset, in increasing order
+  vector<int> movieRecords;
+  vector<int> creditStart;      // getActorCount() + 1 entries
+  vector<int> credits;
+  vector<int> castStart;        // getMovieCount() + 1 entries
+  vector<int> cast;
+  const int *creditList;
+  const int *castList;
+  unsigned int numbering;
+
+  static int findRecord(const vector<int>& records, int record);
+
+  // graphs refer to the imdb and to their own arrays, so they're never copied
+  graph(const graph& original);
+  graph& operator=(const graph& rhs);
+};
+
+#endif
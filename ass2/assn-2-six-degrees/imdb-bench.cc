@@ -0,0 +1,461 @@
+/**
+ * File: imdb-bench.cc
+ * -------------------
+ * Latency benchmarks for the imdb access layer.  Times getCredits,
+ * getCast and findActor one call at a time, first against a cold page
+ * cache (the data files are evicted before each operation's run, and
+ * a fresh imdb maps them again) and then hot, and times path queries
+ * grouped by the distance they turn out to span.  The results, with the
+ * process's memory footprint, are printed on cout as one JSON object, so
+ * runs before and after a change can be compared by a script.
+ *
+ * Any data directory will do, so the same benchmark runs on the real
+ * data and on generated data of whatever size.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "imdb.h"
+#include "path.h"
+#include "search.h"
+#include "graph.h"
+#include "costar-graph.h"
+using namespace std;
+
+static const int kDefaultSampleCount = 10000;
+static const int kDefaultPathCount = 100;
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the options this program understands.
+ */
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " [options]" << endl;
+  cerr << "Prints imdb access and path query latencies as JSON.  The options are:" << endl;
+  cerr << "    --data <directory>  the data to measure (default: the usual data directory)" << endl;
+  cerr << "    --samples <n>       calls to time per operation (default " << kDefaultSampleCount << ")" << endl;
+  cerr << "    --paths <n>         path queries to time (default " << kDefaultPathCount << ")" << endl;
+  cerr << "    --seed <n>          random seed for choosing samples (default 0)" << endl;
+  cerr << "    --costars           also time path queries over the graph and the co-star graph" << endl;
+}
+
+/**
+ * Type: benchSamples
+ * ------------------
+ * The arguments every timed call takes, chosen up front so that choosing
+ * them (which reads names out of the data files) doesn't warm the cache.
+ */
+
+struct benchSamples {
+  vector<string> actors;
+  vector<film> movies;
+  vector<pair<string, string> > pairs;
+};
+
+static void chooseSamples(const string& directory, int sampleCount, int pathCount,
+                          unsigned int seed, benchSamples& samples)
+{
+  imdb db(directory);
+  for (int i = 0; i < sampleCount && db.getActorCount() > 0 && db.getMovieCount() > 0; i++) {
+    samples.actors.push_back(db.getActorName(db.getActorRecord(rand_r(&seed) % db.getActorCount())));
+    int movie = db.getMovieRecord(rand_r(&seed) % db.getMovieCount());
+    film chosen;
+    chosen.title = db.getMovieTitle(movie);
+    chosen.year = db.getMovieYear(movie);
+    samples.movies.push_back(chosen);
+  }
+  for (int i = 0; i < pathCount && db.getActorCount() > 0; i++) {
+    string source = db.getActorName(db.getActorRecord(rand_r(&seed) % db.getActorCount()));
+    string target = db.getActorName(db.getActorRecord(rand_r(&seed) % db.getActorCount()));
+    samples.pairs.push_back(make_pair(source, target));
+  }
+}
+
+static double getElapsedNanoseconds(const struct timespec& start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+}
+
+/**
+ * Functions: listDataFiles
+ *            evictDataFiles
+ *            getResidentFraction
+ * ------------------------------
+ * Find the regular files in the data directory, ask the kernel to drop
+ * them from the page cache, and measure how much of them is still cached.
+ * Eviction is only advice, and pages mapped by any process stay put, so
+ * the benchmark reports the resident fraction rather than assuming it.
+ */
+
+static vector<string> listDataFiles(const string& directory)
+{
+  vector<string> files;
+  DIR *dir = opendir(directory.c_str());
+  if (dir == NULL) return files;
+  for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    string fileName = directory + "/" + entry->d_name;
+    struct stat stats;
+    if (stat(fileName.c_str(), &stats) == 0 && S_ISREG(stats.st_mode) && stats.st_size > 0)
+      files.push_back(fileName);
+  }
+  closedir(dir);
+  return files;
+}
+
+static void evictDataFiles(const vector<string>& files)
+{
+  for (int i = 0; i < (int) files.size(); i++) {
+    int fd = open(files[i].c_str(), O_RDONLY);
+    if (fd == -1) continue;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+static double getResidentFraction(const vector<string>& files)
+{
+  long pageSize = sysconf(_SC_PAGESIZE);
+  long long pages = 0, resident = 0;
+  for (int i = 0; i < (int) files.size(); i++) {
+    int fd = open(files[i].c_str(), O_RDONLY);
+    if (fd == -1) continue;
+    struct stat stats;
+    fstat(fd, &stats);
+    void *map = mmap(NULL, stats.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) continue;
+    size_t count = (stats.st_size + pageSize - 1) / pageSize;
+    vector<unsigned char> residency(count);
+    if (mincore(map, stats.st_size, &residency[0]) == 0) {
+      pages += count;
+      for (size_t page = 0; page < count; page++) resident += residency[page] & 1;
+    }
+    munmap(map, stats.st_size);
+  }
+  return pages > 0 ? (double) resident / pages : 0;
+}
+
+/**
+ * Function: getMemoryKilobytes
+ * ----------------------------
+ * Returns one of the memory figures in /proc/self/status, such as VmRSS
+ * (resident now) or VmHWM (peak resident), or -1 if it isn't there.
+ */
+
+static long getMemoryKilobytes(const string& field)
+{
+  ifstream status("/proc/self/status");
+  string line;
+  while (getline(status, line))
+    if (line.compare(0, field.size() + 1, field + ":") == 0)
+      return atol(line.c_str() + field.size() + 1);
+  return -1;
+}
+
+/**
+ * Type: benchOperation
+ * --------------------
+ * One of the timed calls, applied to the ith sample.
+ */
+
+typedef void (*benchOperation)(const imdb& db, const benchSamples& samples, int i);
+
+static void callGetCredits(const imdb& db, const benchSamples& samples, int i)
+{
+  vector<film> films;
+  db.getCredits(samples.actors[i], films);
+}
+
+static void callGetCast(const imdb& db, const benchSamples& samples, int i)
+{
+  vector<string> players;
+  db.getCast(samples.movies[i], players);
+}
+
+static void callFindActor(const imdb& db, const benchSamples& samples, int i)
+{
+  db.findActor(samples.actors[i].c_str());
+}
+
+static void callFindMovies(const imdb& db, const benchSamples& samples, int i)
+{
+  vector<int> records;
+  db.findMovies(samples.movies[i].title.c_str(), records);
+}
+
+static const struct { const char *name; benchOperation operation; } kOperations[] = {
+  { "getCredits", callGetCredits }, { "getCast", callGetCast }, { "findActor", callFindActor },
+  { "findMovies", callFindMovies }
+};
+static const int kOperationCount = sizeof(kOperations) / sizeof(kOperations[0]);
+
+static vector<double> timeOperation(const imdb& db, const benchSamples& samples,
+                                    benchOperation operation)
+{
+  vector<double> nanoseconds(samples.actors.size());
+  for (int i = 0; i < (int) samples.actors.size(); i++) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    operation(db, samples, i);
+    nanoseconds[i] = getElapsedNanoseconds(start);
+  }
+  return nanoseconds;
+}
+
+static double getPercentile(const vector<double>& sorted, double fraction)
+{
+  if (sorted.empty()) return 0;
+  return sorted[(int) (fraction * (sorted.size() - 1) + 0.5)];
+}
+
+/**
+ * Function: printLatencies
+ * ------------------------
+ * Prints a JSON object summarizing the latencies, in microseconds.
+ */
+
+static void printLatencies(ostream& os, vector<double> nanoseconds)
+{
+  sort(nanoseconds.begin(), nanoseconds.end());
+  double total = 0;
+  for (int i = 0; i < (int) nanoseconds.size(); i++) total += nanoseconds[i];
+  os << "{ \"count\": " << nanoseconds.size()
+     << ", \"mean_us\": " << (nanoseconds.empty() ? 0 : total / nanoseconds.size() / 1e3)
+     << ", \"p50_us\": " << getPercentile(nanoseconds, 0.5) / 1e3
+     << ", \"p99_us\": " << getPercentile(nanoseconds, 0.99) / 1e3
+     << ", \"p999_us\": " << getPercentile(nanoseconds, 0.999) / 1e3
+     << ", \"max_us\": " << (nanoseconds.empty() ? 0 : nanoseconds.back() / 1e3) << " }";
+}
+
+static string quote(const string& text)
+{
+  string quoted = "\"";
+  for (int i = 0; i < (int) text.size(); i++) {
+    if (text[i] == '"' || text[i] == '\\') quoted += '\\';
+    quoted += text[i];
+  }
+  return quoted + "\"";
+}
+
+/**
+ * Function: benchColdAccess
+ * -------------------------
+ * Times each operation on a freshly opened imdb right after evicting the
+ * data files, so that every call pays for whatever pages it touches first.
+ */
+
+static void benchColdAccess(const string& directory, const benchSamples& samples, ostream& os)
+{
+  vector<string> files = listDataFiles(directory);
+  os << "  \"cold\": {" << endl;
+  for (int i = 0; i < kOperationCount; i++) {
+    evictDataFiles(files);
+    double resident = getResidentFraction(files);
+    imdb db(directory);
+    vector<double> nanoseconds = timeOperation(db, samples, kOperations[i].operation);
+    os << "    " << quote(kOperations[i].name) << ": { \"resident_before\": " << resident
+       << ", \"latency\": ";
+    printLatencies(os, nanoseconds);
+    os << " }" << (i + 1 < kOperationCount ? "," : "") << endl;
+  }
+  os << "  }," << endl;
+}
+
+/**
+ * Function: benchHotAccess
+ * ------------------------
+ * Runs every operation once untimed to pull in the pages they need, then
+ * times them again.
+ */
+
+static void benchHotAccess(const imdb& db, const benchSamples& samples, ostream& os)
+{
+  for (int i = 0; i < kOperationCount; i++) timeOperation(db, samples, kOperations[i].operation);
+  os << "  \"hot\": {" << endl;
+  for (int i = 0; i < kOperationCount; i++) {
+    os << "    " << quote(kOperations[i].name) << ": ";
+    printLatencies(os, timeOperation(db, samples, kOperations[i].operation));
+    os << (i + 1 < kOperationCount ? "," : "") << endl;
+  }
+  os << "  }," << endl;
+}
+
+/**
+ * Type: pathSearch
+ * ----------------
+ * One of the ways to answer a path query: over the imdb, over the graph,
+ * or over the co-star graph, passed as structure.  The time includes
+ * translating names to ids, as it does in six-degrees.
+ */
+
+typedef bool (*pathSearch)(const void *structure, const string& source, const string& target,
+                           path& result);
+
+static bool searchImdb(const void *structure, const string& source, const string& target,
+                       path& result)
+{
+  return findShortestPath(*(const imdb *) structure, source, target, result);
+}
+
+static bool searchGraph(const void *structure, const string& source, const string& target,
+                        path& result)
+{
+  const graph& g = *(const graph *) structure;
+  return findShortestPath(g, NULL, g.getActorId(source), g.getActorId(target), result);
+}
+
+static bool searchCostars(const void *structure, const string& source, const string& target,
+                          path& result)
+{
+  const costarGraph& costars = *(const costarGraph *) structure;
+  const graph& g = costars.getGraph();
+  return findShortestPath(costars, g.getActorId(source), g.getActorId(target), result, kMaxDegrees);
+}
+
+/**
+ * Function: benchPaths
+ * --------------------
+ * Times a shortest path search for each sampled pair, and groups the
+ * latencies by the number of movies in the path found, with the pairs
+ * no path of at most kMaxDegrees movies joins grouped as "none".
+ */
+
+static void benchPaths(const char *label, pathSearch search, const void *structure,
+                       const benchSamples& samples, ostream& os)
+{
+  map<int, vector<double> > byDistance;
+  for (int i = 0; i < (int) samples.pairs.size(); i++) {
+    path result(samples.pairs[i].first);
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool found = search(structure, samples.pairs[i].first, samples.pairs[i].second, result);
+    byDistance[found ? result.getLength() : kMaxDegrees + 1].push_back(getElapsedNanoseconds(start));
+  }
+
+  os << "  " << quote(label) << ": [" << endl;
+  for (map<int, vector<double> >::const_iterator group = byDistance.begin();
+       group != byDistance.end(); group++) {
+    os << "    { \"distance\": ";
+    if (group->first > kMaxDegrees) os << "\"none\""; else os << group->first;
+    os << ", \"latency\": ";
+    printLatencies(os, group->second);
+    os << " }";
+    map<int, vector<double> >::const_iterator following = group;
+    os << (++following != byDistance.end() ? "," : "") << endl;
+  }
+  os << "  ]," << endl;
+}
+
+/**
+ * Function: benchCostars
+ * ----------------------
+ * Weighs the co-star graph against the graph it's projected from: how
+ * long it takes to build and how much memory it needs, and path query
+ * latencies over both, for the same pairs as the imdb path benchmark.
+ */
+
+static void benchCostars(const imdb& db, const benchSamples& samples, ostream& os)
+{
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  graph g(db);
+  double graphNanoseconds = getElapsedNanoseconds(start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  costarGraph costars(g);
+  double costarNanoseconds = getElapsedNanoseconds(start);
+
+  os << "  \"costars\": { \"graph_build_ms\": " << graphNanoseconds / 1e6
+     << ", \"graph_bytes\": " << g.getMemoryUsage()
+     << ", \"costar_build_ms\": " << costarNanoseconds / 1e6
+     << ", \"costar_bytes\": " << costars.getMemoryUsage()
+     << ", \"costar_edges\": " << costars.getEdgeCount()
+     << ", \"credits\": " << g.getEdgeCount() << " }," << endl;
+  benchPaths("graph_paths", searchGraph, &g, samples, os);
+  benchPaths("costar_paths", searchCostars, &costars, samples, os);
+}
+
+/**
+ * Function: main
+ * --------------
+ * Chooses the samples, runs the cold benchmarks, then opens the imdb once
+ * for the hot and path benchmarks, and reports memory last.
+ */
+
+int main(int argc, const char *argv[])
+{
+  string directory = determinePathToData();
+  int sampleCount = kDefaultSampleCount;
+  int pathCount = kDefaultPathCount;
+  unsigned int seed = 0;
+  bool compareCostars = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) directory = argv[++i];
+    else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) sampleCount = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--paths") == 0 && i + 1 < argc) pathCount = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoul(argv[++i], NULL, 10);
+    else if (strcmp(argv[i], "--costars") == 0) compareCostars = true;
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  long startKilobytes = getMemoryKilobytes("VmRSS");
+  benchSamples samples;
+  {
+    imdb probe(directory);
+    if (!probe.good()) {
+      cerr << "No data found in \"" << directory << "\".  Aborting..." << endl;
+      return 1;
+    }
+  }
+  chooseSamples(directory, sampleCount, pathCount, seed, samples);
+
+  ostringstream json;
+  json << fixed << setprecision(3);
+  benchColdAccess(directory, samples, json);
+
+  long beforeOpenKilobytes = getMemoryKilobytes("VmRSS");
+  imdb db(directory);
+  long afterOpenKilobytes = getMemoryKilobytes("VmRSS");
+  benchHotAccess(db, samples, json);
+  benchPaths("paths", searchImdb, &db, samples, json);
+  if (compareCostars) benchCostars(db, samples, json);
+
+  size_t dataBytes = db.getActorFileSize() + (db.isCompact() ? 0 : db.getMovieFileSize());
+  cout << fixed << setprecision(3);
+  cout << "{" << endl;
+  cout << "  \"data\": " << quote(directory) << "," << endl;
+  cout << "  \"format\": " << quote(db.isCompact() ? "compact" : "v1") << "," << endl;
+  cout << "  \"actors\": " << db.getActorCount() << ", \"movies\": " << db.getMovieCount()
+       << ", \"seed\": " << seed << "," << endl;
+  cout << json.str();
+  cout << "  \"memory\": { \"data_file_bytes\": " << dataBytes
+       << ", \"rss_start_kb\": " << startKilobytes
+       << ", \"rss_before_open_kb\": " << beforeOpenKilobytes
+       << ", \"rss_after_open_kb\": " << afterOpenKilobytes
+       << ", \"rss_end_kb\": " << getMemoryKilobytes("VmRSS")
+       << ", \"rss_peak_kb\": " << getMemoryKilobytes("VmHWM") << " }" << endl;
+  cout << "}" << endl;
+  return 0;
+}
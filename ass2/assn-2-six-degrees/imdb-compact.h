@@ -0,0 +1,100 @@
+#ifndef __imdb_compact__
+#define __imdb_compact__
+
+#include <vector>
+using namespace std;
+
+/**
+ * File: imdb-compact.h
+ * --------------------
+ * The layout of the compact (version 2) data file, shared by the imdb
+ * class, which reads it, and imdb-convert, which writes it.
+ *
+ * One compact file stands in for both actordata and moviedata.  Actors
+ * and movies are numbered densely, and those ids are also their record
+ * handles.  In a version 2 file the ids are in sorted order (by name, and
+ * by title then year).  A version 3 file is renumbered for locality
+ * instead (see imdb-convert), and adds two sections that list the ids in
+ * sorted order, for looking names up.  The file is a compactHeader, then
+ * sectionCount compactSections, then the sections themselves, each
+ * starting on an 8-byte boundary:
+ *
+ *     kActorNamesSection   an unsigned int per actor: its name's offset in the heap
+ *     kMovieNamesSection   an unsigned int per movie: its title's offset in the heap
+ *     kMovieYearsSection   a signed char per movie: its year, less 1900
+ *     kActorListsSection   an unsigned int per actor: its credits' offset in the adjacency section
+ *     kMovieListsSection   an unsigned int per movie: its cast's offset in the adjacency section
+ *     kAdjacencySection    the lists: a varint count, then the ids in increasing
+ *                          order, each a varint difference from the one before
+ *                          (the first from zero)
+ *     kHeapSection         the NUL-terminated names and titles
+ *     kActorOrderSection   version 3 only: an unsigned int per actor, the ids in name order
+ *     kMovieOrderSection   version 3 only: an unsigned int per movie, the ids in title order
+ *
+ * Every per-actor and per-movie section is in id order, so a version 3
+ * file lays out the names and lists of neighboring ids side by side.
+ * Varints hold seven bits per byte, least significant first, with the high
+ * bit set on every byte but the last.  Everything is in native byte order;
+ * byteOrder lets a reader recognize a file written on another machine.
+ * Readers ignore sections past the ones they know about, so later
+ * versions of this layout can add sections without breaking them.  The
+ * order sections change what the ids mean, which is why a renumbered file
+ * gets a new version number: a reader that only knows version 2 rejects
+ * it rather than binary searching names that aren't in order.
+ */
+
+struct compactHeader {
+  int magic;
+  int version;
+  int byteOrder;
+  int actorCount;
+  int movieCount;
+  int sectionCount;
+  long long creditCount;
+};
+
+struct compactSection {
+  long long offset;    // from the start of the file
+  long long size;      // in bytes
+};
+
+enum {
+  kActorNamesSection,
+  kMovieNamesSection,
+  kMovieYearsSection,
+  kActorListsSection,
+  kMovieListsSection,
+  kAdjacencySection,
+  kHeapSection,
+  kCompactSectionCount,
+  kActorOrderSection = kCompactSectionCount,
+  kMovieOrderSection,
+  kRenumberedSectionCount
+};
+
+static const int kCompactMagic = 0x32444d49;       // "IMD2"
+static const int kCompactVersion = 2;
+static const int kRenumberedVersion = 3;
+static const int kCompactByteOrder = 0x01020304;
+
+inline void appendVarint(vector<unsigned char>& bytes, unsigned int value)
+{
+  while (value >= 0x80) {
+    bytes.push_back((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  bytes.push_back(value);
+}
+
+inline unsigned int readVarint(const unsigned char *& bytes)
+{
+  unsigned int value = 0;
+  int shift = 0;
+  while (*bytes & 0x80) {
+    value |= (unsigned int) (*bytes++ & 0x7f) << shift;
+    shift += 7;
+  }
+  return value | (unsigned int) *bytes++ << shift;
+}
+
+#endif
@@ -0,0 +1,373 @@
+/**
+ * File: imdb-convert.cc
+ * ---------------------
+ * Converts the data in the usual data directory into a single compact
+ * data file (see imdb-compact.h), which imdbs opened on the output
+ * directory use in place of actordata and moviedata.  The input can be in
+ * either format, since it's read through the imdb class.
+ *
+ * Records are normally numbered in sorted order.  --order bfs or --order
+ * rcm renumbers them so that actors and the movies they share get nearby
+ * ids (see computeOrder), which puts their names, lists and the graph's
+ * adjacency arrays near each other in memory; the compact file then keeps
+ * tables of the ids in sorted order to look names up by.
+ *
+ * This is also how a delta (see imdb-update) is compacted: the imdb reads
+ * the data with the delta merged in, so the compact file includes it, and
+ * once that file replaces the data the delta was built on, the delta is
+ * removed.  Programs running on the old files keep them until they exit,
+ * so the compaction can run in the background of a live directory; it
+ * holds the delta lock throughout, so updates wait for it to finish.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "imdb.h"
+#include "imdb-compact.h"
+#include "graph.h"
+using namespace std;
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the options this program understands.
+ */
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " [--out <directory>] [--order name|bfs|rcm]" << endl;
+  cerr << "Writes the compact data file to <directory> (default: the data directory)," << endl;
+  cerr << "numbering records in sorted order (the default), breadth-first order from" << endl;
+  cerr << "the busiest actors, or reverse Cuthill-McKee order." << endl;
+}
+
+enum recordOrder { kNameOrder, kBreadthFirstOrder, kCuthillMcKeeOrder };
+
+/**
+ * Type: renumbering
+ * -----------------
+ * The new numbering, as graph ids listed in new id order (actorAt and
+ * movieAt) and as the new id of each graph id (actorIds and movieIds).
+ */
+
+struct renumbering {
+  vector<int> actorAt;
+  vector<int> movieAt;
+  vector<int> actorIds;
+  vector<int> movieIds;
+};
+
+// orders graph ids by their number of neighbors, fewest first
+struct byNeighborCount {
+  const vector<int>& degrees;
+  byNeighborCount(const vector<int>& degrees) : degrees(degrees) {}
+  bool operator()(int first, int second) const {
+    return degrees[first] != degrees[second] ? degrees[first] < degrees[second] : first < second;
+  }
+};
+
+/**
+ * Function: computeOrder
+ * ----------------------
+ * Lists the actors and movies in the requested order.  Name order is the
+ * order the imdb enumerates them in.  The other two walk the bipartite
+ * actor/movie graph breadth first, numbering actors and movies separately
+ * as they're reached, so that each actor's movies, and each movie's cast,
+ * get ids close to one another.  Each connected component is started
+ * from its busiest unnumbered actor, so the hubs that most searches pass
+ * through come first and end up packed together.
+ *
+ * Breadth-first order visits neighbors in id order.  Cuthill-McKee order
+ * visits them fewest neighbors first, which keeps the spread of each
+ * list's ids (the matrix bandwidth) small, and is then reversed, as in
+ * the reverse Cuthill-McKee ordering used for sparse matrices.  Actors
+ * and movies nobody reaches (movies without a cast) are numbered last.
+ */
+
+static void computeOrder(const graph& g, recordOrder order, renumbering& result)
+{
+  const imdb& db = g.getDatabase();
+  int actorCount = g.getActorCount(), movieCount = g.getMovieCount();
+  result.actorAt.clear();
+  result.movieAt.clear();
+  if (order == kNameOrder) {
+    for (int i = 0; i < actorCount; i++) result.actorAt.push_back(g.getActorId(db.getActorRecord(i)));
+    for (int i = 0; i < movieCount; i++) result.movieAt.push_back(g.getMovieId(db.getMovieRecord(i)));
+  } else {
+    vector<int> actorDegrees(actorCount), movieDegrees(movieCount);
+    for (int actor = 0; actor < actorCount; actor++) actorDegrees[actor] = g.getCreditCount(actor);
+    for (int movie = 0; movie < movieCount; movie++) movieDegrees[movie] = g.getCastCount(movie);
+    vector<int> seeds(actorCount);
+    for (int actor = 0; actor < actorCount; actor++) seeds[actor] = actor;
+    stable_sort(seeds.begin(), seeds.end(), byNeighborCount(actorDegrees));
+    reverse(seeds.begin(), seeds.end());
+
+    vector<bool> actorSeen(actorCount, false), movieSeen(movieCount, false);
+    vector<int> neighbors;
+    for (int s = 0; s < actorCount; s++) {
+      if (actorSeen[seeds[s]]) continue;
+      actorSeen[seeds[s]] = true;
+      size_t nextActor = result.actorAt.size(), nextMovie = result.movieAt.size();
+      result.actorAt.push_back(seeds[s]);
+      // actors and movies alternate levels, so the two lists serve as one queue
+      while (nextActor < result.actorAt.size() || nextMovie < result.movieAt.size()) {
+        while (nextActor < result.actorAt.size()) {
+          int actor = result.actorAt[nextActor++];
+          neighbors.assign(g.creditsBegin(actor), g.creditsEnd(actor));
+          if (order == kCuthillMcKeeOrder)
+            stable_sort(neighbors.begin(), neighbors.end(), byNeighborCount(movieDegrees));
+          for (int i = 0; i < (int) neighbors.size(); i++) {
+            if (movieSeen[neighbors[i]]) continue;
+            movieSeen[neighbors[i]] = true;
+            result.movieAt.push_back(neighbors[i]);
+          }
+        }
+        while (nextMovie < result.movieAt.size()) {
+          int movie = result.movieAt[nextMovie++];
+          neighbors.assign(g.castBegin(movie), g.castEnd(movie));
+          if (order == kCuthillMcKeeOrder)
+            stable_sort(neighbors.begin(), neighbors.end(), byNeighborCount(actorDegrees));
+          for (int i = 0; i < (int) neighbors.size(); i++) {
+            if (actorSeen[neighbors[i]]) continue;
+            actorSeen[neighbors[i]] = true;
+            result.actorAt.push_back(neighbors[i]);
+          }
+        }
+      }
+    }
+    if (order == kCuthillMcKeeOrder) {
+      reverse(result.actorAt.begin(), result.actorAt.end());
+      reverse(result.movieAt.begin(), result.movieAt.end());
+    }
+    for (int movie = 0; movie < movieCount; movie++)
+      if (!movieSeen[movie]) result.movieAt.push_back(movie);
+  }
+
+  result.actorIds.resize(actorCount);
+  result.movieIds.resize(movieCount);
+  for (int i = 0; i < actorCount; i++) result.actorIds[result.actorAt[i]] = i;
+  for (int i = 0; i < movieCount; i++) result.movieIds[result.movieAt[i]] = i;
+}
+
+/**
+ * Function: appendList
+ * --------------------
+ * Encodes one credit or cast list, translated into the new ids and
+ * sorted, as a count followed by the differences between successive ids.
+ */
+
+static void appendList(vector<unsigned char>& adjacency, const int *begin, const int *end,
+                       const vector<int>& newIds, vector<int>& scratch)
+{
+  scratch.clear();
+  for (const int *id = begin; id < end; id++) scratch.push_back(newIds[*id]);
+  sort(scratch.begin(), scratch.end());
+  appendVarint(adjacency, scratch.size());
+  int previous = 0;
+  for (int i = 0; i < (int) scratch.size(); i++) {
+    appendVarint(adjacency, scratch[i] - previous);
+    previous = scratch[i];
+  }
+}
+
+static unsigned int appendName(vector<char>& heap, const char *name)
+{
+  unsigned int offset = heap.size();
+  heap.insert(heap.end(), name, name + strlen(name) + 1);
+  return offset;
+}
+
+// pads the file out to the next 8-byte boundary and returns the position
+static long long alignOutput(ofstream& outfile, long long position)
+{
+  static const char zeros[8] = { 0 };
+  int padding = (8 - position % 8) % 8;
+  outfile.write(zeros, padding);
+  return position + padding;
+}
+
+/**
+ * Function: writeCompactFile
+ * --------------------------
+ * Builds every section in memory, with records numbered as the order
+ * says, then writes the header, the section table and the sections in
+ * order.  Files in any order but name order get the two order sections
+ * and the renumbered version.
+ *
+ * @return true if and only if the file was written in full.
+ */
+
+static bool writeCompactFile(const graph& g, recordOrder order, const string& fileName)
+{
+  const imdb& db = g.getDatabase();
+  int actorCount = g.getActorCount(), movieCount = g.getMovieCount();
+  renumbering ids;
+  computeOrder(g, order, ids);
+  vector<char> heap;
+  vector<unsigned int> actorNames(actorCount), movieNames(movieCount);
+  vector<signed char> movieYears(movieCount);
+  for (int actor = 0; actor < actorCount; actor++)
+    actorNames[actor] = appendName(heap, g.getActorName(ids.actorAt[actor]));
+  for (int movie = 0; movie < movieCount; movie++) {
+    int record = g.getMovieRecord(ids.movieAt[movie]);
+    movieNames[movie] = appendName(heap, db.getMovieTitle(record));
+    movieYears[movie] = db.getMovieYear(record) - 1900;
+  }
+
+  vector<unsigned char> adjacency;
+  vector<unsigned int> actorLists(actorCount), movieLists(movieCount);
+  vector<int> scratch;
+  for (int actor = 0; actor < actorCount; actor++) {
+    actorLists[actor] = adjacency.size();
+    appendList(adjacency, g.creditsBegin(ids.actorAt[actor]), g.creditsEnd(ids.actorAt[actor]),
+               ids.movieIds, scratch);
+  }
+  for (int movie = 0; movie < movieCount; movie++) {
+    movieLists[movie] = adjacency.size();
+    appendList(adjacency, g.castBegin(ids.movieAt[movie]), g.castEnd(ids.movieAt[movie]),
+               ids.actorIds, scratch);
+  }
+
+  // the ids in sorted order, where the imdb enumerates its records in sorted order
+  vector<unsigned int> actorOrder, movieOrder;
+  bool renumbered = order != kNameOrder;
+  if (renumbered) {
+    for (int i = 0; i < actorCount; i++)
+      actorOrder.push_back(ids.actorIds[g.getActorId(db.getActorRecord(i))]);
+    for (int i = 0; i < movieCount; i++)
+      movieOrder.push_back(ids.movieIds[g.getMovieId(db.getMovieRecord(i))]);
+  }
+  int sectionCount = renumbered ? kRenumberedSectionCount : kCompactSectionCount;
+  if (adjacency.size() > 0xffffffffu || heap.size() > 0xffffffffu) {
+    cerr << "The data is too large for 32-bit section offsets." << endl;
+    return false;
+  }
+
+  const void *data[kRenumberedSectionCount] = {
+    actorNames.empty() ? NULL : &actorNames[0], movieNames.empty() ? NULL : &movieNames[0],
+    movieYears.empty() ? NULL : &movieYears[0], actorLists.empty() ? NULL : &actorLists[0],
+    movieLists.empty() ? NULL : &movieLists[0], adjacency.empty() ? NULL : &adjacency[0],
+    heap.empty() ? NULL : &heap[0], actorOrder.empty() ? NULL : &actorOrder[0],
+    movieOrder.empty() ? NULL : &movieOrder[0]
+  };
+  compactSection sections[kRenumberedSectionCount] = {
+    { 0, (long long) (actorNames.size() * sizeof(unsigned int)) },
+    { 0, (long long) (movieNames.size() * sizeof(unsigned int)) },
+    { 0, (long long) movieYears.size() },
+    { 0, (long long) (actorLists.size() * sizeof(unsigned int)) },
+    { 0, (long long) (movieLists.size() * sizeof(unsigned int)) },
+    { 0, (long long) adjacency.size() },
+    { 0, (long long) heap.size() },
+    { 0, (long long) (actorOrder.size() * sizeof(unsigned int)) },
+    { 0, (long long) (movieOrder.size() * sizeof(unsigned int)) }
+  };
+  long long tableSize = sectionCount * sizeof(compactSection);
+  long long position = sizeof(compactHeader) + tableSize;
+  for (int i = 0; i < sectionCount; i++) {
+    position = (position + 7) / 8 * 8;
+    sections[i].offset = position;
+    position += sections[i].size;
+  }
+
+  compactHeader header;
+  header.magic = kCompactMagic;
+  header.version = renumbered ? kRenumberedVersion : kCompactVersion;
+  header.byteOrder = kCompactByteOrder;
+  header.actorCount = actorCount;
+  header.movieCount = movieCount;
+  header.sectionCount = sectionCount;
+  header.creditCount = g.getEdgeCount();
+
+  ofstream outfile(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  outfile.write((const char *) &header, sizeof(header));
+  outfile.write((const char *) sections, tableSize);
+  position = sizeof(header) + tableSize;
+  for (int i = 0; i < sectionCount; i++) {
+    position = alignOutput(outfile, position);
+    if (sections[i].size > 0) outfile.write((const char *) data[i], sections[i].size);
+    position += sections[i].size;
+  }
+  outfile.close();
+  return !outfile.fail();
+}
+
+static bool isSameDirectory(const string& first, const string& second)
+{
+  struct stat firstStats, secondStats;
+  return stat(first.c_str(), &firstStats) == 0 && stat(second.c_str(), &secondStats) == 0 &&
+    firstStats.st_dev == secondStats.st_dev && firstStats.st_ino == secondStats.st_ino;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Opens the imdb in the usual data directory, writes the compact file
+ * under a temporary name and renames it into place, so that a reader
+ * never sees a partial file, and then removes the delta if the new file
+ * has taken the place of the data it extended.
+ */
+
+int main(int argc, const char *argv[])
+{
+  string directory = determinePathToData();
+  recordOrder order = kNameOrder;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      directory = argv[++i];
+    } else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc &&
+               (strcmp(argv[i + 1], "name") == 0 || strcmp(argv[i + 1], "bfs") == 0 ||
+                strcmp(argv[i + 1], "rcm") == 0)) {
+      i++;
+      order = strcmp(argv[i], "name") == 0 ? kNameOrder :
+              strcmp(argv[i], "bfs") == 0 ? kBreadthFirstOrder : kCuthillMcKeeOrder;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  int lock = imdb::lockDelta(determinePathToData());
+  if (lock == -1) {
+    cerr << "Couldn't lock the delta in " << determinePathToData() << "." << endl;
+    return 1;
+  }
+  imdb db(determinePathToData());
+  if (!db.good()) {
+    cerr << "Data directory not found!  Aborting..." << endl;
+    imdb::unlockDelta(lock);
+    return 1;
+  }
+  graph g(db);
+
+  string fileName = directory + "/" + imdb::kCompactFileName;
+  string tempName = fileName + ".tmp";
+  if (!writeCompactFile(g, order, tempName) || rename(tempName.c_str(), fileName.c_str()) != 0) {
+    cerr << "Failed to write " << fileName << "." << endl;
+    remove(tempName.c_str());
+    imdb::unlockDelta(lock);
+    return 1;
+  }
+  if (db.getDeltaCreditCount() > 0 && isSameDirectory(directory, determinePathToData())) {
+    remove((directory + "/" + imdb::kDeltaFileName).c_str());
+    cout << "Folded the delta's " << db.getDeltaCreditCount() << " credits into " << fileName << "." << endl;
+  }
+  imdb::unlockDelta(lock);
+
+  imdb converted(directory);
+  if (!converted.good() || !converted.isCompact()) {
+    cerr << "Wrote " << fileName << ", but couldn't open it again." << endl;
+    return 1;
+  }
+  size_t before = db.getDataSize();
+  size_t after = converted.getDataSize();
+  cout << "Wrote " << fileName << ": " << after << " bytes, down from " << before << " ("
+       << (before > 0 ? 100.0 * after / before : 0) << "%)." << endl;
+  return 0;
+}
@@ -0,0 +1,416 @@
+/**
+ * File: imdb-generate.cc
+ * ----------------------
+ * Writes a synthetic actordata/moviedata pair, in exactly the layout the
+ * imdb class reads, so that six-degrees and its tools can be tested and
+ * benchmarked at any scale without the real data.  The output depends
+ * only on the options, so the same seed always gives the same files.
+ *
+ * Movie cast sizes follow a Pareto distribution, and actors are picked
+ * for each cast slot with a power-law preference for a few popular ones,
+ * so both cast sizes and credit counts have the long tails of the real
+ * data.  Popularity is scattered across the alphabet, so popular actors
+ * aren't all neighbors in the files.  Names and titles are made of fixed
+ * width syllables that sort in the order they're generated, and every
+ * so often a title is remade in a later year.
+ *
+ * The files are generated in two passes over the same random stream: the
+ * first only counts credits, which fixes every record's size and offset,
+ * and the second fills in the records of the output files, mapped in
+ * place.  So memory use grows with the number of actors and movies, not
+ * the number of credits.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "imdb.h"
+using namespace std;
+
+static const long long kDefaultCreditCount = 1000000;
+static const int kDefaultCreditsPerActor = 4;
+static const int kMinCastSize = 5;           // Pareto scale; the mean cast is twice this
+static const double kCastExponent = 2.0;     // Pareto shape
+static const int kMaxCastSize = 2000;
+static const double kPopularity = 2.0;       // actor rank ~ count * u^kPopularity
+static const int kMaxRecordCount = 32767;    // record counts are shorts
+static const double kRemakeChance = 0.03;
+static const int kFirstYear = 1900;
+static const int kLastYear = 2020;
+static const int kMaxTries = 8;              // picks per cast slot before giving up on it
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the options this program understands.
+ */
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " --out <directory> [options]" << endl;
+  cerr << "Writes synthetic actordata and moviedata files to <directory>.  The options are:" << endl;
+  cerr << "    --credits <n>   approximate number of credits (default " << kDefaultCreditCount << ")" << endl;
+  cerr << "    --actors <n>    number of actors (default: one per " << kDefaultCreditsPerActor
+       << " credits)" << endl;
+  cerr << "    --seed <n>      random seed (default 0)" << endl;
+}
+
+/**
+ * Type: randomSource
+ * ------------------
+ * A splitmix64 generator: fast, 64 bits per call, and the same sequence
+ * on every platform, unlike rand_r.
+ */
+
+struct randomSource {
+  unsigned long long state;
+
+  unsigned long long next() {
+    unsigned long long z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // uniform in (0, 1]
+  double nextDouble() { return ((next() >> 11) + 1) * (1.0 / 9007199254740992.0); }
+};
+
+/**
+ * Functions: appendWord
+ *            getActorName
+ *            getMovieTitle
+ * ------------------------
+ * Spell out a number as capitalized words of two-letter syllables, one
+ * syllable per base-100 digit.  Every syllable sorts in the order of its
+ * digit and every name has the same shape, so strcmp orders names the
+ * way their numbers are ordered.
+ */
+
+static const char kConsonants[] = "bcdfghjklmnprstvwxyz";   // 20 of them, in order
+static const char kVowels[] = "aeiou";
+
+static void appendWord(string& text, long long number, int syllables)
+{
+  if (!text.empty()) text += ' ';
+  int start = text.size();
+  long long scale = 1;
+  for (int i = 1; i < syllables; i++) scale *= 100;
+  for (; scale > 0; scale /= 100) {
+    int digit = number / scale % 100;
+    text += kConsonants[digit / 5];
+    text += kVowels[digit % 5];
+  }
+  text[start] = toupper(text[start]);
+}
+
+static string getActorName(long long actor)
+{
+  string name;
+  appendWord(name, actor / 1000000, 2);
+  appendWord(name, actor % 1000000, 3);
+  return name;
+}
+
+static string getMovieTitle(long long title)
+{
+  string name;
+  appendWord(name, title / 10000, 3);
+  appendWord(name, title % 10000, 2);
+  return name;
+}
+
+/**
+ * Type: generator
+ * ---------------
+ * The random stream and the state that decides each pick: how many
+ * credits every actor has so far, which the second pass recounts from
+ * zero so that it makes exactly the picks the first pass did.
+ */
+
+struct generator {
+  randomSource random;
+  long long creditTarget;
+  int actorCount;
+  unsigned long long scatter;   // coprime to actorCount, to spread popularity around
+  vector<int> creditCounts;
+  long long credits;            // generated so far
+  int titleIndex;
+  int year;
+};
+
+static void startPass(generator& gen, unsigned long long seed)
+{
+  gen.random.state = seed;
+  gen.creditCounts.assign(gen.actorCount, 0);
+  gen.credits = 0;
+  gen.titleIndex = -1;
+  gen.year = 0;
+}
+
+static unsigned long long findCoprime(unsigned long long n)
+{
+  unsigned long long candidate = (unsigned long long) (n * 0.6180339887) | 1;
+  while (true) {
+    unsigned long long a = candidate, b = n;
+    while (b != 0) { unsigned long long t = a % b; a = b; b = t; }
+    if (a == 1) return candidate;
+    candidate += 2;
+  }
+}
+
+/**
+ * Function: generateMovie
+ * -----------------------
+ * Makes up the next movie: whether it remakes the last title, its year,
+ * and its cast, as actor ids in increasing order.
+ *
+ * @return false once the credit target has been reached.
+ */
+
+static bool generateMovie(generator& gen, vector<int>& cast)
+{
+  if (gen.credits >= gen.creditTarget) return false;
+  bool remake = gen.titleIndex >= 0 && gen.year < kLastYear &&
+                gen.random.nextDouble() < kRemakeChance;
+  if (remake) {
+    gen.year += 1 + gen.random.next() % min(10, kLastYear - gen.year);
+  } else {
+    gen.titleIndex++;
+    gen.year = kFirstYear + (int) ((kLastYear - kFirstYear) * sqrt(gen.random.nextDouble()));
+  }
+
+  int size = (int) (kMinCastSize * pow(gen.random.nextDouble(), -1.0 / kCastExponent));
+  size = min(size, min(kMaxCastSize, gen.actorCount));
+  size = min((long long) size, gen.creditTarget - gen.credits);
+  cast.clear();
+  for (int slot = 0; slot < size; slot++) {
+    for (int tries = 0; tries < kMaxTries; tries++) {
+      double rank = gen.actorCount * pow(gen.random.nextDouble(), kPopularity);
+      int actor = (min((int) rank, gen.actorCount - 1) * gen.scatter + gen.actorCount / 2) % gen.actorCount;
+      if (gen.creditCounts[actor] >= kMaxRecordCount ||
+          find(cast.begin(), cast.end(), actor) != cast.end()) continue;
+      gen.creditCounts[actor]++;
+      cast.push_back(actor);
+      break;
+    }
+  }
+  gen.credits += cast.size();
+  sort(cast.begin(), cast.end());
+  return true;
+}
+
+/**
+ * Functions: getNameBytes
+ *            getRecordSize
+ * ------------------------
+ * Measure a record: the name (with, for movies, the year byte) padded to
+ * an even length, the short count, padding to a multiple of four, and
+ * then the offsets.
+ */
+
+static int getNameBytes(const string& name, bool movie)
+{
+  int bytes = name.size() + 1 + (movie ? 1 : 0);
+  return bytes + bytes % 2;
+}
+
+static int getRecordSize(int nameBytes, int count)
+{
+  int header = nameBytes + 2;
+  return header + header % 4 + 4 * count;
+}
+
+/**
+ * Type: outputFile
+ * ----------------
+ * One of the two data files, created at its final size and mapped in
+ * for writing.
+ */
+
+struct outputFile {
+  string fileName;
+  char *data;
+  size_t size;
+};
+
+static bool createOutputFile(outputFile& file, long long size)
+{
+  file.data = NULL;
+  file.size = size;
+  int fd = open(file.fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) return false;
+  bool sized = ftruncate(fd, size) == 0;
+  void *map = sized ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  file.data = (char *) map;
+  return true;
+}
+
+static bool closeOutputFile(outputFile& file)
+{
+  if (file.data == NULL) return false;
+  bool synced = msync(file.data, file.size, MS_SYNC) == 0;
+  munmap(file.data, file.size);
+  file.data = NULL;
+  return synced;
+}
+
+/**
+ * Function: writeRecordHeader
+ * ---------------------------
+ * Writes a record's name, year byte (for movies) and count at the
+ * specified offset, and returns the offset of its first list entry.
+ */
+
+static long long writeRecordHeader(outputFile& file, long long offset, const string& name,
+                                   int year, int count)
+{
+  char *record = file.data + offset;
+  memcpy(record, name.c_str(), name.size() + 1);
+  if (year != 0) record[name.size() + 1] = (char) (year - 1900);
+  int nameBytes = getNameBytes(name, year != 0);
+  *(short *) (record + nameBytes) = count;
+  return offset + getRecordSize(nameBytes, 0);
+}
+
+/**
+ * Function: generateFiles
+ * -----------------------
+ * Runs the counting pass, lays out both files, and runs the filling pass.
+ * The offsets in the files are ints, so files of 2GB or more are refused.
+ *
+ * @return true if and only if both files were written in full.
+ */
+
+static bool generateFiles(generator& gen, unsigned long long seed, const string& directory)
+{
+  vector<int> cast;
+  vector<short> castCounts;
+  startPass(gen, seed);
+  while (generateMovie(gen, cast)) castCounts.push_back(cast.size());
+  int movieCount = castCounts.size();
+
+  // every name of a kind has the same length, so only the counts vary
+  int actorNameBytes = getNameBytes(getActorName(0), false);
+  int movieNameBytes = getNameBytes(getMovieTitle(0), true);
+  vector<unsigned int> actorOffsets(gen.actorCount), movieOffsets(movieCount);
+  long long actorFileSize = 4 + 4LL * gen.actorCount, movieFileSize = 4 + 4LL * movieCount;
+  for (int actor = 0; actor < gen.actorCount; actor++) {
+    actorOffsets[actor] = actorFileSize;
+    actorFileSize += getRecordSize(actorNameBytes, gen.creditCounts[actor]);
+    if (actorFileSize > 0x7fffffff) break;
+  }
+  for (int movie = 0; movie < movieCount; movie++) {
+    movieOffsets[movie] = movieFileSize;
+    movieFileSize += getRecordSize(movieNameBytes, castCounts[movie]);
+    if (movieFileSize > 0x7fffffff) break;
+  }
+  if (actorFileSize > 0x7fffffff || movieFileSize > 0x7fffffff) {
+    cerr << "The data would need files of 2GB or more; ask for fewer credits." << endl;
+    return false;
+  }
+
+  outputFile actorFile = { directory + "/actordata", NULL, 0 };
+  outputFile movieFile = { directory + "/moviedata", NULL, 0 };
+  if (!createOutputFile(actorFile, actorFileSize) || !createOutputFile(movieFile, movieFileSize)) {
+    closeOutputFile(actorFile);
+    return false;
+  }
+
+  // the headers, and then each actor's list is filled in movie order
+  vector<unsigned int> nextCredit(gen.actorCount);
+  *(int *) actorFile.data = gen.actorCount;
+  for (int actor = 0; actor < gen.actorCount; actor++) {
+    ((int *) actorFile.data)[actor + 1] = actorOffsets[actor];
+    nextCredit[actor] = writeRecordHeader(actorFile, actorOffsets[actor], getActorName(actor), 0,
+                                          gen.creditCounts[actor]);
+  }
+  *(int *) movieFile.data = movieCount;
+  startPass(gen, seed);
+  for (int movie = 0; generateMovie(gen, cast); movie++) {
+    ((int *) movieFile.data)[movie + 1] = movieOffsets[movie];
+    int *list = (int *) (movieFile.data + writeRecordHeader(movieFile, movieOffsets[movie],
+                                                             getMovieTitle(gen.titleIndex),
+                                                             gen.year, cast.size()));
+    for (int i = 0; i < (int) cast.size(); i++) {
+      list[i] = actorOffsets[cast[i]];
+      *(int *) (actorFile.data + nextCredit[cast[i]]) = movieOffsets[movie];
+      nextCredit[cast[i]] += 4;
+    }
+  }
+
+  bool actorsWritten = closeOutputFile(actorFile);
+  return closeOutputFile(movieFile) && actorsWritten;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Generates the files, then opens them as an imdb to make sure they're
+ * readable and reports their size.
+ */
+
+int main(int argc, const char *argv[])
+{
+  const char *directory = NULL;
+  long long creditTarget = kDefaultCreditCount;
+  long long actorCount = 0;
+  unsigned long long seed = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) directory = argv[++i];
+    else if (strcmp(argv[i], "--credits") == 0 && i + 1 < argc) creditTarget = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--actors") == 0 && i + 1 < argc) actorCount = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+    else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (actorCount <= 0) actorCount = creditTarget / kDefaultCreditsPerActor;
+  if (directory == NULL || creditTarget <= 0 || actorCount <= 0 || actorCount > 0x7fffffff) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+    cerr << "Couldn't create the directory \"" << directory << "\"." << endl;
+    return 1;
+  }
+
+  struct timespec start, finish;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  generator gen;
+  gen.creditTarget = creditTarget;
+  gen.actorCount = actorCount;
+  gen.scatter = findCoprime(actorCount);
+  if (!generateFiles(gen, seed, directory)) {
+    cerr << "Failed to write the data files to \"" << directory << "\"." << endl;
+    return 1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &finish);
+
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Wrote the data files, but couldn't open them again." << endl;
+    return 1;
+  }
+  cout << "Wrote " << db.getActorCount() << " actors, " << db.getMovieCount() << " movies and "
+       << gen.credits << " credits (" << db.getActorFileSize() + db.getMovieFileSize()
+       << " bytes) in " << fixed << setprecision(3)
+       << (finish.tv_sec - start.tv_sec) + (finish.tv_nsec - start.tv_nsec) / 1e9 << " s." << endl;
+  return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * File: imdb-index.cc
+ * -------------------
+ * Builds the optional sidecar indexes that live next to the actordata and
+ * moviedata files.  None of them are required: the imdb class uses each
+ * one only if it's present and matches the data files, so they can be
+ * rebuilt or deleted at any time.
+ */
+
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include "imdb.h"
+#include "graph.h"
+#include "landmark-oracle.h"
+#include "component-index.h"
+using namespace std;
+
+static const int kDefaultLandmarkCount = 16;
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the list of indexes this program knows how to build.
+ */
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " [options] <index> [<index> ...]" << endl;
+  cerr << "where each <index> is one of:" << endl;
+  cerr << "    hash       hash tables from actor name and movie title/year to record" << endl;
+  cerr << "    titles     a hash table from movie title to every year and record" << endl;
+  cerr << "    landmarks  distances from a few landmark actors to every actor" << endl;
+  cerr << "    components the connected component every actor belongs to" << endl;
+  cerr << "and the options are:" << endl;
+  cerr << "    --landmark-count <k>     number of landmarks (default " << kDefaultLandmarkCount << ")" << endl;
+  cerr << "    --random-landmarks <seed>  pick landmarks at random instead of by credits" << endl;
+}
+
+/**
+ * Type: indexOptions
+ * ------------------
+ * The settings gathered from the command line, plus the graph, which is
+ * built the first time an index needs it.
+ */
+
+struct indexOptions {
+  int landmarkCount;
+  bool randomLandmarks;
+  unsigned int seed;
+  graph *g;
+};
+
+static const graph& getGraph(const imdb& db, indexOptions& options)
+{
+  if (options.g == NULL) options.g = new graph(db);
+  return *options.g;
+}
+
+/**
+ * Function: buildIndex
+ * --------------------
+ * Builds the named index in the specified directory.
+ *
+ * @return true if and only if the index was written.
+ */
+
+static bool buildIndex(const imdb& db, const string& name, const string& directory,
+                       indexOptions& options)
+{
+  if (name == "hash") return db.writeHashIndex(directory);
+  if (name == "titles") return db.writeTitleIndex(directory);
+  if (name == "landmarks")
+    return landmarkOracle::build(getGraph(db, options), directory + "/" + landmarkOracle::kFileName,
+                                 options.landmarkCount, options.randomLandmarks, options.seed, 0);
+  if (name == "components")
+    return componentIndex::build(getGraph(db, options), directory + "/" + componentIndex::kFileName);
+  return false;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Opens the imdb in the usual data directory and builds each of the
+ * indexes named on the command line, stopping at the first failure.
+ */
+
+int main(int argc, const char *argv[])
+{
+  indexOptions options = { kDefaultLandmarkCount, false, 0, NULL };
+  vector<string> names;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--landmark-count") == 0 && i + 1 < argc) {
+      options.landmarkCount = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--random-landmarks") == 0 && i + 1 < argc) {
+      options.randomLandmarks = true;
+      options.seed = strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "hash") == 0 || strcmp(argv[i], "titles") == 0 ||
+               strcmp(argv[i], "landmarks") == 0 || strcmp(argv[i], "components") == 0) {
+      names.push_back(argv[i]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (names.empty()) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const char *directory = determinePathToData();
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found!  Aborting..." << endl;
+    return 1;
+  }
+
+  int status = 0;
+  for (int i = 0; i < (int) names.size(); i++) {
+    if (!buildIndex(db, names[i], directory, options)) {
+      cerr << "Failed to write the " << names[i] << " index to " << directory << "." << endl;
+      status = 1;
+      break;
+    }
+    cout << "Wrote the " << names[i] << " index to " << directory << "." << endl;
+  }
+  delete options.g;
+  return status;
+}
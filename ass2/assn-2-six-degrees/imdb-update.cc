@@ -0,0 +1,108 @@
+/**
+ * File: imdb-update.cc
+ * --------------------
+ * Adds credits to the data in the usual data directory without rewriting
+ * the data files.  Each line of standard input names an actor, a movie
+ * title and the movie's year, separated by tabs; the credits are merged
+ * into the directory's delta (see imdb::writeDelta), which every imdb
+ * opened on the directory afterwards layers over the data files.  Actors
+ * and movies the data doesn't have yet are created along the way.
+ * Programs already running keep answering from the data they opened.
+ *
+ * The delta is meant to stay small.  imdb-convert folds it into a new
+ * compact data file and removes it, and can do so while other programs
+ * are still using the directory.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+#include "imdb.h"
+using namespace std;
+
+static void usage(const char *program)
+{
+  cerr << "Usage: " << program << " < credits" << endl;
+  cerr << "where each line of credits is an actor, a title and a year, separated by tabs." << endl;
+}
+
+/**
+ * Function: readCredits
+ * ---------------------
+ * Reads tab-separated credits from the stream, skipping empty lines.
+ *
+ * @return true if and only if every other line was a valid credit.
+ */
+
+static bool readCredits(istream& in, vector<credit>& credits)
+{
+  string line;
+  for (int number = 1; getline(in, line); number++) {
+    if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+    if (line.empty()) continue;
+    vector<string> fields;
+    istringstream tokens(line);
+    for (string field; getline(tokens, field, '\t');) fields.push_back(field);
+    char *end = NULL;
+    long year = fields.size() == 3 ? strtol(fields[2].c_str(), &end, 10) : 0;
+    if (fields.size() != 3 || fields[0].empty() || fields[1].empty() || *end != '\0' ||
+        year < 1900 - 128 || year > 1900 + 127) {
+      cerr << "Line " << number << " isn't an actor, a title and a year from "
+           << 1900 - 128 << " to " << 1900 + 127 << "." << endl;
+      return false;
+    }
+    credit added;
+    added.player = fields[0];
+    added.movie.title = fields[1];
+    added.movie.year = year;
+    credits.push_back(added);
+  }
+  return true;
+}
+
+/**
+ * Function: main
+ * --------------
+ * Reads the credits, then holds the delta lock while it opens the imdb
+ * and writes the extended delta, so that concurrent updates and
+ * compactions take turns.
+ */
+
+int main(int argc, const char *argv[])
+{
+  if (argc != 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  vector<credit> credits;
+  if (!readCredits(cin, credits)) return 1;
+
+  const char *directory = determinePathToData();
+  int lock = imdb::lockDelta(directory);
+  if (lock == -1) {
+    cerr << "Couldn't lock the delta in " << directory << "." << endl;
+    return 1;
+  }
+  imdb db(directory);
+  if (!db.good()) {
+    cerr << "Data directory not found!  Aborting..." << endl;
+    imdb::unlockDelta(lock);
+    return 1;
+  }
+  if (!db.writeDelta(directory, credits)) {
+    cerr << "Failed to write the delta to " << directory << "." << endl;
+    imdb::unlockDelta(lock);
+    return 1;
+  }
+
+  imdb updated(directory);
+  imdb::unlockDelta(lock);
+  cout << "Added " << updated.getActorCount() - db.getActorCount() << " actors, "
+       << updated.getMovieCount() - db.getMovieCount() << " movies and "
+       << updated.getDeltaCreditCount() - db.getDeltaCreditCount() << " credits; the delta now holds "
+       << updated.getDeltaCreditCount() << " credits." << endl;
+  return 0;
+}
@@ -62,11 +62,10 @@ inline const char *determinePathToData(const char *userSelectedPath = NULL)
     return "data/little-endian/";
 }
 
-/*
 struct key {
   const char *name;
   int year;       // for actors this field is left empty
   const void *file;
 };
-*/
+
 #endif
@@ -4,119 +4,976 @@ using namespace std;
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/file.h>
 #include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <errno.h>
+#include <fstream>
+#include <algorithm>
+#include <set>
 #include "imdb.h"
 
 const char *const imdb::kActorFileName = "actordata";
 const char *const imdb::kMovieFileName = "moviedata";
+const char *const imdb::kIndexFileName = "nameindex";
+const char *const imdb::kTitleIndexFileName = "titleindex";
+const char *const imdb::kCompactFileName = "imdbdata";
+const char *const imdb::kDeltaFileName = "imdbdelta";
 
-imdb::imdb(const string& directory)
+static void buildSearchIndex(const void *file, bool movies, vector<imdb::searchEntry>& tree);
+
+imdb::imdb(const string& directory, int options)
 {
   const string actorFileName = directory + "/" + kActorFileName;
   const string movieFileName = directory + "/" + kMovieFileName;
   
-  actorFile = acquireFileMap(actorFileName, actorInfo);
-  movieFile = acquireFileMap(movieFileName, movieInfo);
+  actorFile = movieFile = NULL;
+  actorSlots = movieSlots = NULL;
+  titleSlots = NULL;
+  titleEntries = NULL;
+  actorCount = movieCount = 0;
+  deltaActorCount = deltaMovieCount = deltaCreditCount = 0;
+  actorLimit = movieLimit = INT_MAX;
+  actorInfo.fd = movieInfo.fd = indexInfo.fd = titleInfo.fd = deltaInfo.fd = -1;
+  actorInfo.fileMap = movieInfo.fileMap = indexInfo.fileMap = titleInfo.fileMap = NULL;
+  deltaInfo.fileMap = NULL;
+  deltaInfo.fileSize = 0;
+  compact = acquireCompactFile(directory + "/" + kCompactFileName, options);
+  if (compact) {
+    acquireDelta(directory + "/" + kDeltaFileName);
+    acquireTitleIndex(directory + "/" + kTitleIndexFileName);
+    return;
+  }
+
+  actorFile = acquireFileMap(actorFileName, actorInfo, options);
+  movieFile = acquireFileMap(movieFileName, movieInfo, options);
+  if (good()) {
+    actorCount = *((const int*)actorFile);
+    movieCount = *((const int*)movieFile);
+  }
+  if (good()) acquireHashIndex(directory + "/" + kIndexFileName);
+  if (good()) acquireDelta(directory + "/" + kDeltaFileName);
+  if (good()) acquireTitleIndex(directory + "/" + kTitleIndexFileName);
+  if (good() && (options & kSearchIndex)) {
+    buildSearchIndex(actorFile, false, actorIndex);
+    buildSearchIndex(movieFile, true, movieIndex);
+  }
 }
 
 bool imdb::good() const
 {
-  return !( (actorInfo.fd == -1) || 
-	    (movieInfo.fd == -1) ); 
+  return compact || !( (actorInfo.fileMap == NULL) || 
+	               (movieInfo.fileMap == NULL) ); 
 }
 
-film get_film (const void *file, int offset) {
-  
-  char *ptr = ((char*)file) + offset;
-  film ans;
-  ans.title = string(ptr);
-  int len = ans.title.size();
-  ans.year = 1900 + (int)(*(ptr + len + 1));
-  return ans;
+// the comparators work on the raw bytes of the mapped records, so a
+// bsearch probe never builds a string or a film
+
+static int compareMovies (const void *first, const void *second) {
+  const key *cur_key = (const key*)first;
+  const char *title = (const char*)cur_key->file + *((const int*)second);
+  int cmp = strcmp(cur_key->name, title);
+  if (cmp != 0) return cmp;
+  return cur_key->year - (1900 + (int)(*(title + strlen(title) + 1)));
 }
 
-int compareMovies (const void *first, const void *second) {
-  key *cur_key = (key*)first;
-  const void *file = cur_key->file;  
-  film first_film;
-  film sec_film;
+static int compareActors(const void *first, const void *second) {
+  const key *cur_key = (const key*)first;
+  return strcmp(cur_key->name, (const char*)cur_key->file + *((const int*)second));
+}
 
-  first_film.title = string(cur_key->name);
-  first_film.year = cur_key->year;
-  sec_film = get_film(file, *((int*)second));
+/**
+ * The optional search index stores the sorted offset array in Eytzinger
+ * (breadth-first binary tree) order, so the first several levels of every
+ * search share a handful of cache lines.  Each entry also caches the
+ * first eight bytes of its name packed big-endian, so most probes are
+ * settled by one integer comparison without touching the record at all.
+ */
 
-  if (first_film == sec_film) return 0;
-  if (first_film < sec_film) return -1;
-  return 1;
+static unsigned long long getKeyPrefix(const char *name)
+{
+  unsigned long long prefix = 0;
+  int i = 0;
+  for (; i < 8 && name[i] != '\0'; i++)
+    prefix = (prefix << 8) | (unsigned char) name[i];
+  return prefix << (8 * (8 - i));
+}
 
+static void buildSearchTree(const int *sorted, int count, const void *file, bool movies,
+                            vector<imdb::searchEntry>& tree, int& next, int node)
+{
+  if (node > count) return;
+  buildSearchTree(sorted, count, file, movies, tree, next, 2 * node);
+  const char *name = (const char*)file + sorted[next];
+  tree[node].prefix = getKeyPrefix(name);
+  tree[node].offset = sorted[next++];
+  tree[node].year = movies ? 1900 + (int)(*(name + strlen(name) + 1)) : 0;
+  buildSearchTree(sorted, count, file, movies, tree, next, 2 * node + 1);
 }
 
-int compareActors(const void *first, const void *second) {
+static void buildSearchIndex(const void *file, bool movies, vector<imdb::searchEntry>& tree)
+{
+  int count = *((const int*)file);
+  tree.resize(count + 1);
+  int next = 0;
+  buildSearchTree((const int*)file + 1, count, file, movies, tree, next, 1);
+}
 
-  const void *file = ((key*)first)->file;
-  string first_name = ((key*)first)->name;
-  int sec_off = *((int*) second);
-  char *sec_name = ((char*)file) + sec_off;
+// three-way comparison of a search entry against the key; names only
+// need to be compared beyond the prefix when all eight bytes matched
+static int compareEntry(const imdb::searchEntry& entry, unsigned long long prefix,
+                        const key& to_search)
+{
+  if (entry.prefix != prefix) return entry.prefix < prefix ? -1 : 1;
+  if ((prefix & 0xff) != 0) {
+    int cmp = strcmp((const char*)to_search.file + entry.offset + 8, to_search.name + 8);
+    if (cmp != 0) return cmp;
+  }
+  return entry.year - to_search.year;
+}
 
-  return strcmp(&(first_name[0]), sec_name);
+static int searchIndex(const vector<imdb::searchEntry>& tree, const key& to_search)
+{
+  int count = tree.size() - 1;
+  unsigned long long prefix = getKeyPrefix(to_search.name);
+  int node = 1;
+  while (node <= count)
+    node = 2 * node + (compareEntry(tree[node], prefix, to_search) < 0);
+  node >>= __builtin_ffs(~node);  // undo the right turns taken past the answer
+  if (node == 0 || compareEntry(tree[node], prefix, to_search) != 0) return -1;
+  return tree[node].offset;
 }
 
+/**
+ * The name index file is a small header followed by the actor table and
+ * then the movie table.  Each table is a power-of-two array of hashSlots,
+ * probed linearly from hash & (slots - 1) and kept at most half full.
+ * The header records the sizes of the data files the index was built
+ * from, so a stale index is ignored rather than trusted.  Everything is
+ * written in native byte order; the magic number doubles as a check.
+ */
 
-bool imdb::getCredits(const string& player, vector<film>& films) const {
+struct hashIndexHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  int actorSlotCount;
+  int movieSlotCount;
+};
 
-  key to_search;
-  to_search.name = &(player[0]);
-  to_search.file = actorFile;
-  void *found_actor = bsearch(&to_search, (int*)actorFile+1, *((int*) actorFile), sizeof(int), compareActors);
-  if (found_actor == NULL) return false;
+static const int kHashIndexMagic = 0x58444d49;  // "IMDX"
+static const int kHashIndexVersion = 1;
 
-  // actor is already found
-  char *actor_ptr = (char*)actorFile + *((int*)found_actor);
-  int len = strlen(actor_ptr) + 1;
-  if (len % 2) len++;
-  char *ptr = actor_ptr + len;
-  short movies_num = *((short*)ptr);
-  ptr += 2;
-  if ((len+2) % 4) ptr += 2;
-  int *offsets = (int*)ptr;
-  
-  for (short i = 0; i < movies_num; i++) {
-    films.push_back(get_film(movieFile, offsets[i]));
+// FNV-1a over the name, then over the stored year byte for movies
+static unsigned int hashKey(const key& to_search, bool movies)
+{
+  unsigned int hash = 2166136261u;
+  for (const unsigned char *ptr = (const unsigned char*)to_search.name; *ptr != '\0'; ptr++)
+    hash = (hash ^ *ptr) * 16777619u;
+  if (movies) hash = (hash ^ (unsigned char)(to_search.year - 1900)) * 16777619u;
+  return hash;
+}
+
+static void buildHashTable(const void *file, bool movies, vector<imdb::hashSlot>& table)
+{
+  int count = *((const int*)file);
+  int slots = 2;
+  while (slots < 2 * count) slots *= 2;
+  imdb::hashSlot empty = { 0, -1 };
+  table.assign(slots, empty);
+
+  const int *offsets = (const int*)file + 1;
+  for (int i = 0; i < count; i++) {
+    key to_search;
+    to_search.name = (const char*)file + offsets[i];
+    to_search.year = movies ? 1900 + (int)(*(to_search.name + strlen(to_search.name) + 1)) : 0;
+    unsigned int hash = hashKey(to_search, movies);
+    int slot = hash & (slots - 1);
+    while (table[slot].offset != -1) slot = (slot + 1) & (slots - 1);
+    table[slot].hash = hash;
+    table[slot].offset = offsets[i];
+  }
+}
+
+static int probeHashTable(const imdb::hashSlot *slots, int mask, const key& to_search, bool movies)
+{
+  unsigned int hash = hashKey(to_search, movies);
+  for (int slot = hash & mask; slots[slot].offset != -1; slot = (slot + 1) & mask) {
+    if (slots[slot].hash != hash) continue;
+    const char *name = (const char*)to_search.file + slots[slot].offset;
+    if (strcmp(name, to_search.name) != 0) continue;
+    if (!movies || 1900 + (int)(*(name + strlen(name) + 1)) == to_search.year)
+      return slots[slot].offset;
+  }
+  return -1;
+}
+
+bool imdb::writeHashIndex(const string& directory) const
+{
+  if (compact) return false;
+  vector<hashSlot> actorTable, movieTable;
+  buildHashTable(actorFile, false, actorTable);
+  buildHashTable(movieFile, true, movieTable);
+
+  hashIndexHeader header;
+  header.magic = kHashIndexMagic;
+  header.version = kHashIndexVersion;
+  header.actorFileSize = actorInfo.fileSize;
+  header.movieFileSize = movieInfo.fileSize;
+  header.actorSlotCount = actorTable.size();
+  header.movieSlotCount = movieTable.size();
+
+  ofstream out((directory + "/" + kIndexFileName).c_str(), ios::out | ios::binary | ios::trunc);
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)&actorTable[0], actorTable.size() * sizeof(hashSlot));
+  out.write((const char*)&movieTable[0], movieTable.size() * sizeof(hashSlot));
+  out.close();
+  return !out.fail();
+}
+
+void imdb::acquireHashIndex(const string& fileName)
+{
+  if (acquireFileMap(fileName, indexInfo) == NULL) return;
+  if (indexInfo.fileSize < sizeof(hashIndexHeader)) {
+    releaseFileMap(indexInfo);
+    indexInfo.fd = -1;
+    indexInfo.fileMap = NULL;
+    return;
+  }
+
+  const hashIndexHeader *header = (const hashIndexHeader*)indexInfo.fileMap;
+  bool valid = header->magic == kHashIndexMagic && header->version == kHashIndexVersion &&
+    header->actorFileSize == (long long) actorInfo.fileSize &&
+    header->movieFileSize == (long long) movieInfo.fileSize &&
+    header->actorSlotCount > 0 && (header->actorSlotCount & (header->actorSlotCount - 1)) == 0 &&
+    header->movieSlotCount > 0 && (header->movieSlotCount & (header->movieSlotCount - 1)) == 0 &&
+    indexInfo.fileSize == sizeof(hashIndexHeader) +
+      ((size_t) header->actorSlotCount + header->movieSlotCount) * sizeof(hashSlot);
+  if (!valid) {
+    releaseFileMap(indexInfo);
+    indexInfo.fd = -1;
+    indexInfo.fileMap = NULL;
+    return;
+  }
+
+  actorSlots = (const hashSlot*)(header + 1);
+  movieSlots = actorSlots + header->actorSlotCount;
+  actorSlotMask = header->actorSlotCount - 1;
+  movieSlotMask = header->movieSlotCount - 1;
+}
+
+/**
+ * The title index file is a header, a power-of-two table of titleSlots
+ * kept at most half full and probed linearly, then one titleEntry per
+ * movie, in sorted (title, year) order so that every title's entries are
+ * a contiguous run.  Like the name index, it records the data file sizes
+ * it was built from and is written in native byte order.
+ */
+
+struct titleIndexHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  int slotCount;
+  int entryCount;
+};
+
+static const int kTitleIndexMagic = 0x58544d49;  // "IMTX"
+static const int kTitleIndexVersion = 1;
+
+bool imdb::writeTitleIndex(const string& directory) const
+{
+  int movieCount = getMovieCount();   // including any the delta adds
+  int slots = 2;
+  while (slots < 2 * movieCount) slots *= 2;
+  titleSlot empty = { 0, -1, 0 };
+  vector<titleSlot> table(slots, empty);
+  vector<titleEntry> entries(movieCount);
+  for (int i = 0; i < movieCount; i++) {
+    entries[i].record = getMovieRecord(i);
+    entries[i].year = getMovieYear(entries[i].record);
+    const char *title = getMovieTitle(entries[i].record);
+    if (i > 0 && strcmp(title, getMovieTitle(entries[i - 1].record)) == 0) continue;
+    key to_search;
+    to_search.name = title;
+    to_search.year = 0;
+    unsigned int hash = hashKey(to_search, false);
+    int slot = hash & (slots - 1);
+    while (table[slot].count != 0) slot = (slot + 1) & (slots - 1);
+    table[slot].hash = hash;
+    table[slot].first = i;
+    int last = i + 1;
+    while (last < movieCount && strcmp(getMovieTitle(getMovieRecord(last)), title) == 0) last++;
+    table[slot].count = last - i;
+  }
+
+  titleIndexHeader header;
+  header.magic = kTitleIndexMagic;
+  header.version = kTitleIndexVersion;
+  header.actorFileSize = getActorFileSize();
+  header.movieFileSize = getMovieFileSize();
+  header.slotCount = slots;
+  header.entryCount = movieCount;
+
+  ofstream out((directory + "/" + kTitleIndexFileName).c_str(), ios::out | ios::binary | ios::trunc);
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)&table[0], table.size() * sizeof(titleSlot));
+  if (!entries.empty()) out.write((const char*)&entries[0], entries.size() * sizeof(titleEntry));
+  out.close();
+  return !out.fail();
+}
+
+void imdb::acquireTitleIndex(const string& fileName)
+{
+  if (acquireFileMap(fileName, titleInfo) == NULL) return;
+  const titleIndexHeader *header = (const titleIndexHeader*)titleInfo.fileMap;
+  bool valid = titleInfo.fileSize >= sizeof(titleIndexHeader) &&
+    header->magic == kTitleIndexMagic && header->version == kTitleIndexVersion &&
+    header->actorFileSize == (long long) getActorFileSize() &&
+    header->movieFileSize == (long long) getMovieFileSize() &&
+    header->slotCount > 0 && (header->slotCount & (header->slotCount - 1)) == 0 &&
+    header->entryCount == getMovieCount() &&
+    titleInfo.fileSize == sizeof(titleIndexHeader) + (size_t) header->slotCount * sizeof(titleSlot) +
+      (size_t) header->entryCount * sizeof(titleEntry);
+  if (!valid) {
+    releaseFileMap(titleInfo);
+    titleInfo.fd = -1;
+    titleInfo.fileMap = NULL;
+    return;
+  }
+
+  titleSlots = (const titleSlot*)(header + 1);
+  titleEntries = (const titleEntry*)(titleSlots + header->slotCount);
+  titleSlotMask = header->slotCount - 1;
+}
+
+/**
+ * A delta file is a header, then its tables as arrays of ints: the new
+ * actors' names, the new movies' titles and years, and the credits as
+ * (actor, movie) pairs in both sorted orders, followed by a heap of the
+ * names themselves.  Delta actors and movies are numbered up from just
+ * past the largest record the data files could hold (their size, or
+ * their record count for a compact file), in sorted order, so their
+ * records never collide with those of the files.  The header records the
+ * sizes of the files the delta extends, and everything is written in
+ * native byte order.
+ */
+
+struct deltaHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  int actorCount;
+  int movieCount;
+  int creditCount;
+  int heapSize;
+};
+
+static const int kDeltaMagic = 0x4c444d49;  // "IMDL"
+static const int kDeltaVersion = 1;
+
+// compares a delta entry with a name, and with a year too for movies
+static int compareDeltaEntry(const int *names, const int *years, const char *heap, int entry,
+                             const char *name, int year)
+{
+  int cmp = strcmp(heap + names[entry], name);
+  if (cmp != 0 || years == NULL) return cmp;
+  return years[entry] - year;
+}
+
+static int findDeltaEntry(const int *names, const int *years, const char *heap, int count,
+                          const char *name, int year)
+{
+  int low = 0, high = count;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (compareDeltaEntry(names, years, heap, mid, name, year) < 0) low = mid + 1;
+    else high = mid;
+  }
+  return low < count && compareDeltaEntry(names, years, heap, low, name, year) == 0 ? low : -1;
+}
+
+// appends the values paired with key in the delta's sorted pairs, if any, to the list
+static void appendDeltaRun(recordList& list, const int *keys, const int *values, int count, int key)
+{
+  pair<const int *, const int *> run = equal_range(keys, keys + count, key);
+  if (run.first != run.second) list.append(values + (run.first - keys), run.second - run.first);
+}
+
+/**
+ * The merged order is kept as the position of each delta entry within
+ * it; delta entry j goes in front of positions[j] - j entries from the
+ * files.  Both lookups are binary searches over the positions.
+ */
+
+// the merged position of the entry at index in the files' own order
+static int getMergedIndex(const vector<int>& positions, int index)
+{
+  int low = 0, high = positions.size();
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (positions[mid] - mid <= index) low = mid + 1;
+    else high = mid;
   }
+  return index + low;
+}
+
+// the delta entry at merged position index, or -1 and the files' own index
+static int splitMergedIndex(const vector<int>& positions, int index, int& baseIndex)
+{
+  int before = upper_bound(positions.begin(), positions.end(), index) - positions.begin();
+  baseIndex = index - before;
+  return before > 0 && positions[before - 1] == index ? before - 1 : -1;
+}
+
+int imdb::getMergedActorRecord(int index) const
+{
+  int baseIndex, entry = splitMergedIndex(actorPositions, index, baseIndex);
+  return entry != -1 ? actorLimit + entry : getBaseActorRecord(baseIndex);
+}
+
+int imdb::getMergedMovieRecord(int index) const
+{
+  int baseIndex, entry = splitMergedIndex(moviePositions, index, baseIndex);
+  return entry != -1 ? movieLimit + entry : getBaseMovieRecord(baseIndex);
+}
+
+static bool validDeltaNames(const int *names, int count, int heapSize)
+{
+  for (int i = 0; i < count; i++)
+    if (names[i] < 0 || names[i] >= heapSize) return false;
+  return true;
+}
 
+static bool validDeltaRecords(const int *records, int count, long long limit)
+{
+  for (int i = 0; i < count; i++)
+    if (records[i] < 0 || records[i] >= limit) return false;
   return true;
 }
 
-bool imdb::getCast(const film& movie, vector<string>& players) const {
+void imdb::acquireDelta(const string& fileName)
+{
+  if (acquireFileMap(fileName, deltaInfo) == NULL) return;
+  const deltaHeader *header = (const deltaHeader*)deltaInfo.fileMap;
+  long long firstActor = compact ? actorCount : actorInfo.fileSize;
+  long long firstMovie = compact ? movieCount : movieInfo.fileSize;
+  bool valid = deltaInfo.fileSize >= sizeof(deltaHeader) &&
+    header->magic == kDeltaMagic && header->version == kDeltaVersion &&
+    header->actorFileSize == (long long) getActorBaseSize() &&
+    header->movieFileSize == (long long) getMovieBaseSize() &&
+    header->actorCount >= 0 && header->movieCount >= 0 && header->creditCount >= 0 &&
+    header->heapSize >= 0 && firstActor + header->actorCount <= INT_MAX &&
+    firstMovie + header->movieCount <= INT_MAX &&
+    deltaInfo.fileSize == sizeof(deltaHeader) + header->heapSize +
+      ((size_t) header->actorCount + 2 * (size_t) header->movieCount +
+       4 * (size_t) header->creditCount) * sizeof(int);
+  if (valid) {
+    const int *tables = (const int*)(header + 1);
+    delta.actorNames = tables;
+    delta.movieNames = delta.actorNames + header->actorCount;
+    delta.movieYears = delta.movieNames + header->movieCount;
+    delta.creditActors = delta.movieYears + header->movieCount;
+    delta.creditMovies = delta.creditActors + header->creditCount;
+    delta.castMovies = delta.creditMovies + header->creditCount;
+    delta.castActors = delta.castMovies + header->creditCount;
+    delta.heap = (const char*)(delta.castActors + header->creditCount);
+    long long actorEnd = firstActor + header->actorCount, movieEnd = firstMovie + header->movieCount;
+    valid = (header->heapSize == 0 || delta.heap[header->heapSize - 1] == '\0') &&
+      validDeltaNames(delta.actorNames, header->actorCount, header->heapSize) &&
+      validDeltaNames(delta.movieNames, header->movieCount, header->heapSize) &&
+      validDeltaRecords(delta.creditActors, header->creditCount, actorEnd) &&
+      validDeltaRecords(delta.creditMovies, header->creditCount, movieEnd) &&
+      validDeltaRecords(delta.castMovies, header->creditCount, movieEnd) &&
+      validDeltaRecords(delta.castActors, header->creditCount, actorEnd);
+  }
+  if (!valid) {
+    releaseFileMap(deltaInfo);
+    deltaInfo.fd = -1;
+    deltaInfo.fileMap = NULL;
+    deltaInfo.fileSize = 0;
+    return;
+  }
 
-  /*
-  key *to_search;
-  to_search->name = &(movie.title[0]);
-  to_search->year = movie.year;
-  to_search->file = movieFile;
-  */
-  key to_search;
-  to_search.name = &(movie.title[0]);
-  to_search.year = movie.year;
-  to_search.file = movieFile;
+  deltaActorCount = header->actorCount;
+  deltaMovieCount = header->movieCount;
+  deltaCreditCount = header->creditCount;
+  actorLimit = firstActor;
+  movieLimit = firstMovie;
 
-  void *found_movie = bsearch(&to_search, (int*)movieFile+1, *((int*) movieFile), sizeof(int), compareMovies);
-  if (found_movie == NULL) return false;
+  // each entry's place among the files' records; the search resumes where
+  // the last one ended, since the delta is sorted too
+  actorPositions.resize(deltaActorCount);
+  for (int entry = 0, low = 0; entry < deltaActorCount; entry++) {
+    const char *name = getActorName(actorLimit + entry);
+    int high = actorCount;
+    while (low < high) {
+      int mid = low + (high - low) / 2;
+      if (strcmp(getActorName(getBaseActorRecord(mid)), name) < 0) low = mid + 1;
+      else high = mid;
+    }
+    actorPositions[entry] = low + entry;
+  }
+  moviePositions.resize(deltaMovieCount);
+  for (int entry = 0, low = 0; entry < deltaMovieCount; entry++) {
+    const char *title = getMovieTitle(movieLimit + entry);
+    int year = getMovieYear(movieLimit + entry);
+    int high = movieCount;
+    while (low < high) {
+      int mid = low + (high - low) / 2;
+      int record = getBaseMovieRecord(mid);
+      int cmp = strcmp(getMovieTitle(record), title);
+      if (cmp < 0 || (cmp == 0 && getMovieYear(record) < year)) low = mid + 1;
+      else high = mid;
+    }
+    moviePositions[entry] = low + entry;
+  }
+}
+
+// true if the credit is already in the files, as opposed to the delta
+static bool hasBaseCredit(recordList credits, int movie)
+{
+  for (int record; credits.next(record);)
+    if (record == movie) return true;
+  return false;
+}
+
+bool imdb::writeDelta(const string& directory, const vector<credit>& added) const
+{
+  // the delta's own records are renumbered as it grows, so start from names
+  vector<credit> credits(added);
+  for (int i = 0; i < deltaCreditCount; i++) {
+    credit existing;
+    existing.player = getActorName(delta.creditActors[i]);
+    existing.movie.title = getMovieTitle(delta.creditMovies[i]);
+    existing.movie.year = getMovieYear(delta.creditMovies[i]);
+    credits.push_back(existing);
+  }
+
+  set<string> newActors;
+  set<film> newMovies;
+  for (int i = 0; i < (int) credits.size(); i++) {
+    if (credits[i].movie.year < 1900 - 128 || credits[i].movie.year > 1900 + 127) return false;
+    if (findBaseActor(credits[i].player.c_str()) == -1) newActors.insert(credits[i].player);
+    if (findBaseMovie(credits[i].movie.title.c_str(), credits[i].movie.year) == -1)
+      newMovies.insert(credits[i].movie);
+  }
+  vector<string> actors(newActors.begin(), newActors.end());
+  vector<film> movies(newMovies.begin(), newMovies.end());
+  long long firstActor = compact ? actorCount : actorInfo.fileSize;
+  long long firstMovie = compact ? movieCount : movieInfo.fileSize;
+  if (firstActor + (long long) actors.size() > INT_MAX || firstMovie + (long long) movies.size() > INT_MAX)
+    return false;
+
+  vector<pair<int, int> > byActor, byMovie;
+  for (int i = 0; i < (int) credits.size(); i++) {
+    const credit& c = credits[i];
+    int actor = findBaseActor(c.player.c_str());
+    int movie = findBaseMovie(c.movie.title.c_str(), c.movie.year);
+    if (actor != -1 && movie != -1 && hasBaseCredit(getBaseCreditRecords(actor), movie)) continue;
+    if (actor == -1) actor = firstActor + (lower_bound(actors.begin(), actors.end(), c.player) - actors.begin());
+    if (movie == -1) movie = firstMovie + (lower_bound(movies.begin(), movies.end(), c.movie) - movies.begin());
+    byActor.push_back(make_pair(actor, movie));
+  }
+  sort(byActor.begin(), byActor.end());
+  byActor.erase(unique(byActor.begin(), byActor.end()), byActor.end());
+  for (int i = 0; i < (int) byActor.size(); i++)
+    byMovie.push_back(make_pair(byActor[i].second, byActor[i].first));
+  sort(byMovie.begin(), byMovie.end());
+
+  string fileName = directory + "/" + kDeltaFileName;
+  if (byActor.empty()) return remove(fileName.c_str()) == 0 || errno == ENOENT;
+
+  vector<int> tables;
+  vector<char> heap;
+  for (int i = 0; i < (int) actors.size(); i++) {
+    tables.push_back(heap.size());
+    heap.insert(heap.end(), actors[i].c_str(), actors[i].c_str() + actors[i].size() + 1);
+  }
+  for (int i = 0; i < (int) movies.size(); i++) {
+    tables.push_back(heap.size());
+    heap.insert(heap.end(), movies[i].title.c_str(), movies[i].title.c_str() + movies[i].title.size() + 1);
+  }
+  for (int i = 0; i < (int) movies.size(); i++) tables.push_back(movies[i].year);
+  for (int i = 0; i < (int) byActor.size(); i++) tables.push_back(byActor[i].first);
+  for (int i = 0; i < (int) byActor.size(); i++) tables.push_back(byActor[i].second);
+  for (int i = 0; i < (int) byMovie.size(); i++) tables.push_back(byMovie[i].first);
+  for (int i = 0; i < (int) byMovie.size(); i++) tables.push_back(byMovie[i].second);
+
+  deltaHeader header;
+  header.magic = kDeltaMagic;
+  header.version = kDeltaVersion;
+  header.actorFileSize = getActorBaseSize();
+  header.movieFileSize = getMovieBaseSize();
+  header.actorCount = actors.size();
+  header.movieCount = movies.size();
+  header.creditCount = byActor.size();
+  header.heapSize = heap.size();
+
+  // written aside and renamed into place, so a reader never maps half a delta
+  string tempName = fileName + ".tmp";
+  ofstream out(tempName.c_str(), ios::out | ios::binary | ios::trunc);
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)&tables[0], tables.size() * sizeof(int));
+  if (!heap.empty()) out.write(&heap[0], heap.size());
+  out.close();
+  if (out.fail() || rename(tempName.c_str(), fileName.c_str()) != 0) {
+    remove(tempName.c_str());
+    return false;
+  }
+  return true;
+}
 
-  // movie is already found
-  char *movie_ptr = (char*)movieFile + *((int*)found_movie);
-  int len = strlen(movie_ptr) + 2;
+int imdb::lockDelta(const string& directory)
+{
+  string fileName = directory + "/" + kDeltaFileName + ".lock";
+  int fd = open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd == -1) return -1;
+  while (flock(fd, LOCK_EX) != 0) {
+    if (errno == EINTR) continue;
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void imdb::unlockDelta(int lock)
+{
+  if (lock != -1) close(lock);
+}
+
+/**
+ * A compact file is accepted only if its header matches one of this
+ * build's versions and its byte order, and every section lies within the
+ * file and is the size its table implies.
+ */
+
+static bool validSection(const compactSection& section, size_t fileSize, long long expectedSize)
+{
+  return section.offset >= 0 && section.size >= 0 &&
+    (unsigned long long) section.offset + section.size <= fileSize &&
+    (expectedSize < 0 || section.size == expectedSize);
+}
+
+bool imdb::acquireCompactFile(const string& fileName, int options)
+{
+  if (acquireFileMap(fileName, compactInfo, options) == NULL) return false;
+  const char *base = (const char*)compactInfo.fileMap;
+  const compactHeader *header = (const compactHeader*)base;
+  const compactSection *sections = (const compactSection*)(header + 1);
+  bool renumbered = compactInfo.fileSize >= sizeof(compactHeader) &&
+    header->version == kRenumberedVersion;
+  bool valid = compactInfo.fileSize >= sizeof(compactHeader) &&
+    header->magic == kCompactMagic && (header->version == kCompactVersion || renumbered) &&
+    header->byteOrder == kCompactByteOrder && header->actorCount >= 0 && header->movieCount >= 0 &&
+    header->sectionCount >= (renumbered ? kRenumberedSectionCount : kCompactSectionCount) &&
+    compactInfo.fileSize >= sizeof(compactHeader) + (size_t) header->sectionCount * sizeof(compactSection);
+  if (valid) {
+    long long actors = header->actorCount, movies = header->movieCount;
+    valid = validSection(sections[kActorNamesSection], compactInfo.fileSize, actors * sizeof(int)) &&
+      validSection(sections[kMovieNamesSection], compactInfo.fileSize, movies * sizeof(int)) &&
+      validSection(sections[kMovieYearsSection], compactInfo.fileSize, movies) &&
+      validSection(sections[kActorListsSection], compactInfo.fileSize, actors * sizeof(int)) &&
+      validSection(sections[kMovieListsSection], compactInfo.fileSize, movies * sizeof(int)) &&
+      validSection(sections[kAdjacencySection], compactInfo.fileSize, -1) &&
+      validSection(sections[kHeapSection], compactInfo.fileSize, -1) &&
+      (!renumbered ||
+       (validSection(sections[kActorOrderSection], compactInfo.fileSize, actors * sizeof(int)) &&
+        validSection(sections[kMovieOrderSection], compactInfo.fileSize, movies * sizeof(int))));
+  }
+  if (!valid) {
+    releaseFileMap(compactInfo);
+    compactInfo.fd = -1;
+    compactInfo.fileMap = NULL;
+    return false;
+  }
+
+  actorCount = header->actorCount;
+  movieCount = header->movieCount;
+  layout.actorNames = (const unsigned int*)(base + sections[kActorNamesSection].offset);
+  layout.movieNames = (const unsigned int*)(base + sections[kMovieNamesSection].offset);
+  layout.movieYears = (const signed char*)(base + sections[kMovieYearsSection].offset);
+  layout.actorLists = (const unsigned int*)(base + sections[kActorListsSection].offset);
+  layout.movieLists = (const unsigned int*)(base + sections[kMovieListsSection].offset);
+  layout.adjacency = (const unsigned char*)(base + sections[kAdjacencySection].offset);
+  layout.heap = base + sections[kHeapSection].offset;
+  layout.actorOrder = layout.movieOrder = NULL;
+  if (renumbered) {
+    layout.actorOrder = (const unsigned int*)(base + sections[kActorOrderSection].offset);
+    layout.movieOrder = (const unsigned int*)(base + sections[kMovieOrderSection].offset);
+  }
+  return true;
+}
+
+// binary search over a compact file's name table, visited in sorted order
+// through order (or in place, if order is NULL); returns the position in
+// that order.  years is NULL for actors
+static int searchCompact(const unsigned int *names, const signed char *years, const char *heap,
+                         const unsigned int *order, int count, const key& to_search)
+{
+  int low = 0, high = count;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    int id = order == NULL ? mid : order[mid];
+    int cmp = strcmp(heap + names[id], to_search.name);
+    if (cmp == 0 && years != NULL) cmp = 1900 + years[id] - to_search.year;
+    if (cmp == 0) return mid;
+    if (cmp < 0) low = mid + 1; else high = mid;
+  }
+  return -1;
+}
+
+static recordList getCompactList(const unsigned char *adjacency, unsigned int offset)
+{
+  const unsigned char *ptr = adjacency + offset;
+  int count = readVarint(ptr);
+  return recordList(ptr, count);
+}
+
+/**
+ * Both kinds of record are a NUL-terminated name (followed by a year byte
+ * for movies), padded out to an even length, then a short count, padded
+ * out to a multiple of four bytes, then that many int offsets into the
+ * other file.  headerLength covers the name and, for movies, the year.
+ */
+
+static recordList getRecordList(const char *record, int headerLength)
+{
+  int len = headerLength;
   if (len % 2) len++;
-  char *ptr = movie_ptr + len;
-  short actors_num = *((short*)ptr);
+  const char *ptr = record + len;
+  short count = *((short*)ptr);
   ptr += 2;
   if ((len+2) % 4) ptr += 2;
-  int *offsets = (int*)ptr;
+  return recordList((const int*)ptr, count);
+}
+
+int imdb::findBaseActor(const char *player) const
+{
+  key to_search;
+  to_search.name = player;
+  to_search.year = 0;
+  to_search.file = actorFile;
+  if (compact) {
+    int index = searchCompact(layout.actorNames, NULL, layout.heap, layout.actorOrder, actorCount,
+                              to_search);
+    return index == -1 ? -1 : getBaseActorRecord(index);
+  }
+  if (actorSlots != NULL) return probeHashTable(actorSlots, actorSlotMask, to_search, false);
+  if (!actorIndex.empty()) return searchIndex(actorIndex, to_search);
+  void *found_actor = bsearch(&to_search, (int*)actorFile+1, *((int*) actorFile), sizeof(int), compareActors);
+  if (found_actor == NULL) return -1;
+  return *((int*)found_actor);
+}
+
+int imdb::findActorIndex(const char *player) const
+{
+  key to_search;
+  to_search.name = player;
+  to_search.year = 0;
+  to_search.file = actorFile;
+  int index;
+  if (compact) {
+    index = searchCompact(layout.actorNames, NULL, layout.heap, layout.actorOrder, actorCount, to_search);
+  } else {
+    void *found_actor = bsearch(&to_search, (int*)actorFile+1, *((int*) actorFile), sizeof(int), compareActors);
+    index = found_actor == NULL ? -1 : (int*)found_actor - ((int*)actorFile+1);
+  }
+  if (actorPositions.empty()) return index;
+  if (index != -1) return getMergedIndex(actorPositions, index);
+  int entry = findDeltaEntry(delta.actorNames, NULL, delta.heap, deltaActorCount, player, 0);
+  return entry == -1 ? -1 : actorPositions[entry];
+}
+
+int imdb::findBaseMovie(const char *title, int year) const
+{
+  key to_search;
+  to_search.name = title;
+  to_search.year = year;
+  to_search.file = movieFile;
+  if (compact) {
+    int index = searchCompact(layout.movieNames, layout.movieYears, layout.heap, layout.movieOrder,
+                              movieCount, to_search);
+    return index == -1 ? -1 : getBaseMovieRecord(index);
+  }
+  if (movieSlots != NULL) return probeHashTable(movieSlots, movieSlotMask, to_search, true);
+  if (!movieIndex.empty()) return searchIndex(movieIndex, to_search);
+  void *found_movie = bsearch(&to_search, (int*)movieFile+1, *((int*) movieFile), sizeof(int), compareMovies);
+  if (found_movie == NULL) return -1;
+  return *((int*)found_movie);
+}
 
-  for (short i = 0; i < actors_num; i++) {
-    players.push_back(string((char*)actorFile + offsets[i]));
-  }  
+int imdb::findActor(const char *player) const
+{
+  int record = findBaseActor(player);
+  if (record != -1 || deltaActorCount == 0) return record;
+  int entry = findDeltaEntry(delta.actorNames, NULL, delta.heap, deltaActorCount, player, 0);
+  return entry == -1 ? -1 : actorLimit + entry;
+}
+
+int imdb::findMovie(const char *title, int year) const
+{
+  int record = findBaseMovie(title, year);
+  if (record != -1 || deltaMovieCount == 0) return record;
+  int entry = findDeltaEntry(delta.movieNames, delta.movieYears, delta.heap, deltaMovieCount,
+                             title, year);
+  return entry == -1 ? -1 : movieLimit + entry;
+}
+
+int imdb::findMovies(const char *title, vector<int>& records) const
+{
+  records.clear();
+  if (titleSlots != NULL) {
+    key to_search;
+    to_search.name = title;
+    to_search.year = 0;
+    unsigned int hash = hashKey(to_search, false);
+    for (int slot = hash & titleSlotMask; titleSlots[slot].count != 0; slot = (slot + 1) & titleSlotMask) {
+      if (titleSlots[slot].hash != hash) continue;
+      const titleEntry *entry = titleEntries + titleSlots[slot].first;
+      if (strcmp(getMovieTitle(entry->record), title) != 0) continue;
+      for (int i = 0; i < titleSlots[slot].count; i++) records.push_back(entry[i].record);
+      break;
+    }
+    return records.size();
+  }
+
+  // the first movie whose title isn't less than the one sought
+  int low = 0, high = getMovieCount();
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (strcmp(getMovieTitle(getMovieRecord(mid)), title) < 0) low = mid + 1;
+    else high = mid;
+  }
+  for (int i = low; i < getMovieCount() && strcmp(getMovieTitle(getMovieRecord(i)), title) == 0; i++)
+    records.push_back(getMovieRecord(i));
+  return records.size();
+}
 
+const char *imdb::getActorName(int actor) const
+{
+  if (actor >= actorLimit) return delta.heap + delta.actorNames[actor - actorLimit];
+  if (compact) return layout.heap + layout.actorNames[actor];
+  return (const char*)actorFile + actor;
+}
+
+const char *imdb::getMovieTitle(int movie) const
+{
+  if (movie >= movieLimit) return delta.heap + delta.movieNames[movie - movieLimit];
+  if (compact) return layout.heap + layout.movieNames[movie];
+  return (const char*)movieFile + movie;
+}
+
+int imdb::getMovieYear(int movie) const
+{
+  if (movie >= movieLimit) return delta.movieYears[movie - movieLimit];
+  if (compact) return 1900 + layout.movieYears[movie];
+  const char *title = getMovieTitle(movie);
+  return 1900 + (int)(*(title + strlen(title) + 1));
+}
+
+recordList imdb::getBaseCreditRecords(int actor) const
+{
+  if (actor >= actorLimit) return recordList();
+  if (compact) return getCompactList(layout.adjacency, layout.actorLists[actor]);
+  const char *actor_ptr = getActorName(actor);
+  return getRecordList(actor_ptr, strlen(actor_ptr) + 1);
+}
+
+recordList imdb::getBaseCastRecords(int movie) const
+{
+  if (movie >= movieLimit) return recordList();
+  if (compact) return getCompactList(layout.adjacency, layout.movieLists[movie]);
+  const char *movie_ptr = getMovieTitle(movie);
+  return getRecordList(movie_ptr, strlen(movie_ptr) + 2);
+}
+
+recordList imdb::getCreditRecords(int actor) const
+{
+  recordList credits = getBaseCreditRecords(actor);
+  if (deltaCreditCount > 0) appendDeltaRun(credits, delta.creditActors, delta.creditMovies,
+                                           deltaCreditCount, actor);
+  return credits;
+}
+
+recordList imdb::getCastRecords(int movie) const
+{
+  recordList cast = getBaseCastRecords(movie);
+  if (deltaCreditCount > 0) appendDeltaRun(cast, delta.castMovies, delta.castActors,
+                                           deltaCreditCount, movie);
+  return cast;
+}
+
+// a compact list's offset is a load of its own, which can miss too, but
+// the loads for a batch of records are independent and overlap anyway
+static inline void prefetchAddress(const void *address)
+{
+#ifdef __GNUC__
+  __builtin_prefetch(address);
+#endif
+}
+
+void imdb::prefetchCredits(int actor) const
+{
+  if (actor >= actorLimit) return;
+  if (compact) prefetchAddress(layout.adjacency + layout.actorLists[actor]);
+  else prefetchAddress((const char*)actorFile + actor);
+}
+
+void imdb::prefetchCast(int movie) const
+{
+  if (movie >= movieLimit) return;
+  if (compact) prefetchAddress(layout.adjacency + layout.movieLists[movie]);
+  else prefetchAddress((const char*)movieFile + movie);
+}
+
+bool imdb::mapCredits(const string& player, RecordMapFunction fn, void *auxData) const
+{
+  int actor = findActor(player.c_str());
+  if (actor == -1) return false;
+  recordList credits = getCreditRecords(actor);
+  for (int movie; credits.next(movie);) fn(movie, auxData);
+  return true;
+}
+
+bool imdb::mapCast(const film& movie, RecordMapFunction fn, void *auxData) const
+{
+  int found = findMovie(movie.title.c_str(), movie.year);
+  if (found == -1) return false;
+  recordList cast = getCastRecords(found);
+  for (int actor; cast.next(actor);) fn(actor, auxData);
+  return true;
+}
+
+// the string-building interface is a thin wrapper over the record views
+
+bool imdb::getCredits(const string& player, vector<film>& films) const
+{
+  int actor = findActor(player.c_str());
+  if (actor == -1) return false;
+  recordList credits = getCreditRecords(actor);
+  films.reserve(films.size() + credits.size());
+  for (int movie; credits.next(movie);) {
+    film credit;
+    credit.title = getMovieTitle(movie);
+    credit.year = getMovieYear(movie);
+    films.push_back(credit);
+  }
+  return true;
+}
+
+bool imdb::getCast(const film& movie, vector<string>& players) const
+{
+  int found = findMovie(movie.title.c_str(), movie.year);
+  if (found == -1) return false;
+  recordList cast = getCastRecords(found);
+  players.reserve(players.size() + cast.size());
+  for (int actor; cast.next(actor);)
+    players.push_back(getActorName(actor));
   return true;
 }
 
@@ -124,21 +981,92 @@ imdb::~imdb()
 {
   releaseFileMap(actorInfo);
   releaseFileMap(movieInfo);
+  releaseFileMap(indexInfo);
+  releaseFileMap(titleInfo);
+  releaseFileMap(deltaInfo);
+  releaseFileMap(compactInfo);
 }
 
 // ignore everything below... it's all UNIXy stuff in place to make a file look like
 // an array of bytes in RAM.. 
-const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info)
+
+static const size_t kPageSize = 4096;
+static const size_t kHugePageSize = 2 << 20;
+
+// reads one byte from every page, so the faults are all taken up front
+static void touchPages(const void *map, size_t size)
+{
+  const volatile char *bytes = (const volatile char *) map;
+  char sum = 0;
+  for (size_t offset = 0; offset < size; offset += kPageSize) sum ^= bytes[offset];
+  (void) sum;
+}
+
+// moves the file's contents into anonymous memory the kernel may back with
+// huge pages, returning the new mapping, or NULL to keep the file mapping
+static void *copyToHugePages(const void *fileMap, size_t fileSize, size_t& mapSize)
+{
+#ifdef MADV_HUGEPAGE
+  mapSize = (fileSize + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+  void *copy = mmap(0, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (copy == MAP_FAILED) return NULL;
+  madvise(copy, mapSize, MADV_HUGEPAGE);
+  memcpy(copy, fileMap, fileSize);
+  mprotect(copy, mapSize, PROT_READ);
+  return copy;
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * Maps the named file in read-only, applying whichever of the mapping
+ * options were requested.  Failures leave info.fd at -1 and info.fileMap
+ * at NULL, and return NULL.
+ */
+
+const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info, int options)
 {
+  info.fd = -1;
+  info.fileMap = NULL;
+  info.fileSize = info.mapSize = 0;
   struct stat stats;
-  stat(fileName.c_str(), &stats);
-  info.fileSize = stats.st_size;
-  info.fd = open(fileName.c_str(), O_RDONLY);
-  return info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+  if (stat(fileName.c_str(), &stats) != 0 || stats.st_size == 0) return NULL;
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd == -1) return NULL;
+
+  int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+  if ((options & kPopulate) && !(options & kHugePages)) flags |= MAP_POPULATE;
+#endif
+  void *map = mmap(0, stats.st_size, PROT_READ, flags, fd, 0);
+  if (map == MAP_FAILED) {
+    close(fd);
+    return NULL;
+  }
+  info.fd = fd;
+  info.fileSize = info.mapSize = stats.st_size;
+  info.fileMap = map;
+
+  if (options & kHugePages) {
+    size_t mapSize;
+    void *copy = copyToHugePages(map, info.fileSize, mapSize);
+    if (copy != NULL) {
+      munmap((char *) map, info.fileSize);
+      info.fileMap = map = copy;
+      info.mapSize = mapSize;
+      return map;                            // already resident, so the hints below don't apply
+    }
+  }
+
+  if (options & kAdviseRandom) madvise(map, info.mapSize, MADV_RANDOM);
+  if (options & kAdviseWillNeed) madvise(map, info.mapSize, MADV_WILLNEED);
+  if (options & kWarmup) touchPages(map, info.fileSize);
+  return map;
 }
 
 void imdb::releaseFileMap(struct fileInfo& info)
 {
-  if (info.fileMap != NULL) munmap((char *) info.fileMap, info.fileSize);
+  if (info.fileMap != NULL) munmap((char *) info.fileMap, info.mapSize);
   if (info.fd != -1) close(info.fd);
 }
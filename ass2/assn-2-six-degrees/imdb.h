@@ -2,10 +2,107 @@
 #define __imdb__
 
 #include "imdb-utils.h"
+#include "imdb-compact.h"
 #include <string>
 #include <vector>
 using namespace std;
 
+/**
+ * Convenience class: recordList
+ * -----------------------------
+ * A read-only cursor over the record offsets stored inside a single
+ * actor or movie record (an actor's credits, or a movie's cast).  Nothing
+ * is copied: the cursor walks the offsets in place, so it stays valid
+ * for as long as the imdb that produced it.  Lists in a compact file are
+ * delta encoded (see imdb-compact.h) and are decoded as they're walked.
+ * A list can continue into a second run of plain offsets, which is how
+ * the credits an imdb delta adds follow those in the data files.
+ */
+
+class recordList {
+ public:
+  recordList() : cur(NULL), encoded(NULL), remaining(0), last(0), extra(NULL), extraRemaining(0) {}
+  recordList(const int *offsets, int size) :
+    cur(offsets), encoded(NULL), remaining(size), last(0), extra(NULL), extraRemaining(0) {}
+  recordList(const unsigned char *encoded, int size) :
+    cur(NULL), encoded(encoded), remaining(size), last(0), extra(NULL), extraRemaining(0) {}
+
+  /**
+   * Method: size
+   * ------------
+   * Returns the number of records not yet consumed by next.
+   */
+
+  int size() const { return remaining + extraRemaining; }
+
+  /**
+   * Method: append
+   * --------------
+   * Adds a run of plain offsets to be walked once the list is used up.
+   * A list takes at most one such run.
+   */
+
+  void append(const int *offsets, int size) {
+    extra = offsets;
+    extraRemaining = size;
+  }
+
+  /**
+   * Method: next
+   * ------------
+   * Copies the next record offset into the supplied int and advances.
+   *
+   * @param record updated with the next record offset.
+   * @return false if and only if the list was already exhausted.
+   */
+
+  bool next(int& record) {
+    if (remaining == 0) {
+      if (extraRemaining == 0) return false;
+      cur = extra;
+      encoded = NULL;
+      remaining = extraRemaining;
+      extraRemaining = 0;
+    }
+    remaining--;
+    if (encoded == NULL) {
+      record = *cur++;
+    } else {
+      last += readVarint(encoded);
+      record = last;
+    }
+    return true;
+  }
+
+ private:
+  const int *cur;
+  const unsigned char *encoded;  // NULL unless the list is delta encoded
+  int remaining;
+  int last;
+  const int *extra;              // the appended run, if any
+  int extraRemaining;
+};
+
+/**
+ * Type: RecordMapFunction
+ * -----------------------
+ * Client callback for imdb::mapCredits and imdb::mapCast, called once
+ * per record with the client data pointer passed in by the caller.
+ */
+
+typedef void (*RecordMapFunction)(int record, void *auxData);
+
+/**
+ * Convenience struct: credit
+ * --------------------------
+ * One actor's appearance in one film, as added by imdb::writeDelta.
+ */
+
+struct credit {
+  string player;
+  film movie;
+};
+
 class imdb {
   
  public:
@@ -19,10 +116,49 @@ class imdb {
    * all of the information about the movies and actors relevant to an IMDB
    * application (like six-degrees).
    *
+   * By default lookups binary search the sorted offset arrays at the front
+   * of each file.  Passing kSearchIndex builds an in-memory search tree
+   * over both files at open time (about 16 bytes per actor and movie,
+   * plus one pass over every name) in exchange for faster lookups.  If the
+   * directory also holds a name index (see writeHashIndex), it is mapped
+   * in and takes precedence over both.
+   *
+   * If the directory holds a compact data file (see imdb-compact.h and
+   * imdb-convert), it's opened instead of actordata and moviedata, and
+   * record handles are dense ids rather than byte offsets.  The search
+   * and name indexes only apply to the original files; a compact imdb
+   * binary searches its own sorted name tables.
+   *
+   * If the directory holds a delta (see writeDelta) built on top of the
+   * data files that were opened, its actors, movies and credits are merged
+   * into every answer as it's given: lookups that miss the data files try
+   * the delta's sorted tables, credit and cast lists carry on into the
+   * delta's, and actors and movies are enumerated in merged order.
+   * Nothing is copied or rebuilt at open time, so a small delta costs a
+   * few binary searches per query rather than a rewrite of the files.
+   *
+   * The remaining options trade startup time for fewer page faults once
+   * queries start.  kPopulate asks the kernel to read both data files in
+   * while mapping them, and kWarmup touches every page right after.
+   * kAdviseRandom turns off readahead, which suits lookups on a cold cache;
+   * kAdviseWillNeed starts reading the files in the background instead.
+   * kHugePages copies the files into anonymous memory backed by
+   * transparent huge pages, so that the whole database needs a few
+   * hundred TLB entries rather than one per 4KB page.  Options the
+   * platform doesn't support are ignored.
+   *
    * @param directory the name of the directory housing the formatted information backing the imdb.
+   * @param options zero or more of the option flags below, or'ed together.
    */
 
-  imdb(const string& directory);
+  static const int kSearchIndex = 0x1;
+  static const int kPopulate = 0x2;
+  static const int kWarmup = 0x4;
+  static const int kAdviseRandom = 0x8;
+  static const int kAdviseWillNeed = 0x10;
+  static const int kHugePages = 0x20;
+
+  imdb(const string& directory, int options = 0);
 
   /**
    * Predicate Method: good
@@ -74,8 +210,302 @@ class imdb {
 
   bool getCast(const film& movie, vector<string>& players) const;
 
+  /**
+   * Methods: findActor
+   *          findMovie
+   * ------------------
+   * Locate an actor or movie record without building any strings.
+   * Records are identified by their byte offset into the backing
+   * actor or movie file; those are the same ints that the credit
+   * and cast lists themselves store.  Records a delta adds are
+   * numbered past the end of the files.
+   *
+   * @return the record offset, or -1 if there's no such actor/movie.
+   */
+
+  int findActor(const char *player) const;
+  int findMovie(const char *title, int year) const;
+
+  /**
+   * Method: findActorIndex
+   * ----------------------
+   * Like findActor, but returns the actor's position in sorted name
+   * order (see getActorRecord), for indexing per-actor arrays.
+   *
+   * @return the index, or -1 if there's no such actor.
+   */
+
+  int findActorIndex(const char *player) const;
+
+  /**
+   * Method: findMovies
+   * ------------------
+   * Locates every movie with the specified title, whatever its year, so
+   * remakes and ambiguous titles can be told apart without guessing
+   * years.  If the directory holds a title index (see writeTitleIndex),
+   * that's a single hash probe; otherwise it's one binary search for the
+   * first movie with the title, since movies sort by title and then year.
+   *
+   * @param title the title being queried.
+   * @param records cleared, then updated with the movie records, in
+   *                increasing year order.
+   * @return the number of movies found.
+   */
+
+  int findMovies(const char *title, vector<int>& records) const;
+
+  /**
+   * Methods: getActorName
+   *          getMovieTitle
+   *          getMovieYear
+   * ----------------------
+   * Read the fields of an actor or movie record in place.  The returned
+   * C strings point into the mapped files and must not be freed.
+   */
+
+  const char *getActorName(int actor) const;
+  const char *getMovieTitle(int movie) const;
+  int getMovieYear(int movie) const;
+
+  /**
+   * Methods: getActorCount
+   *          getActorRecord
+   *          getMovieCount
+   *          getMovieRecord
+   * ------------------------
+   * Enumerate every actor and movie record, in sorted name (or title,
+   * then year) order.  Position i in that order is a dense index
+   * suitable for arrays keyed by actor or movie.  Records usually come
+   * in the same order, but those of a renumbered compact file don't.
+   */
+
+  int getActorCount() const { return actorCount + deltaActorCount; }
+  int getActorRecord(int index) const {
+    return actorPositions.empty() ? getBaseActorRecord(index) : getMergedActorRecord(index);
+  }
+  int getMovieCount() const { return movieCount + deltaMovieCount; }
+  int getMovieRecord(int index) const {
+    return moviePositions.empty() ? getBaseMovieRecord(index) : getMergedMovieRecord(index);
+  }
+
+  /**
+   * Methods: getActorFileSize
+   *          getMovieFileSize
+   * --------------------------
+   * Return the sizes of the two data files (both are the size of the
+   * compact file, if that's what was opened), plus the size of the delta,
+   * if one is applied, since it changes the data too.  Sidecar files
+   * record them so that a sidecar built for some other data can be
+   * recognized.
+   */
+
+  size_t getActorFileSize() const { return getActorBaseSize() + deltaInfo.fileSize; }
+  size_t getMovieFileSize() const { return getMovieBaseSize() + deltaInfo.fileSize; }
+
+  /**
+   * Method: getDataSize
+   * -------------------
+   * Returns the number of bytes the data was read from: the two data files
+   * or the compact file, plus the delta if one is applied.
+   */
+
+  size_t getDataSize() const {
+    return (compact ? compactInfo.fileSize : actorInfo.fileSize + movieInfo.fileSize) + deltaInfo.fileSize;
+  }
+
+  /**
+   * Predicate Method: isCompact
+   * ---------------------------
+   * Returns true if and only if the imdb was opened on a compact file.
+   */
+
+  bool isCompact() const { return compact; }
+
+  /**
+   * Constant: kCompactFileName
+   * --------------------------
+   * The name of the compact data file within a data directory.
+   */
+
+  static const char *const kCompactFileName;
+
+  /**
+   * Method: writeDelta
+   * ------------------
+   * Writes a delta holding the credits in this imdb's current delta, if
+   * it has one, plus the added credits, into the specified directory
+   * (normally the one it was opened from), replacing the old delta in a
+   * single rename.  Actors and movies the data files don't have are
+   * added along with their first credit; credits the data already holds
+   * are dropped.  Deltas only ever grow: folding one into the data files
+   * is the job of imdb-convert, which rewrites them as a compact file.
+   *
+   * The delta records the sizes of the data files it was built on and is
+   * ignored by imdbs that open any others.  Callers should hold the lock
+   * from lockDelta from before opening the imdb until the delta is
+   * written, so that two writers can't both extend the same old delta.
+   *
+   * @param directory the directory the delta should be written to.
+   * @param added the credits to add; years must be within 128 of 1900.
+   * @return true if and only if the delta was written in full.
+   */
+
+  bool writeDelta(const string& directory, const vector<credit>& added) const;
+
+  /**
+   * Methods: lockDelta
+   *          unlockDelta
+   * -------------------
+   * Take and release an exclusive lock on the delta in the specified
+   * directory, blocking while anyone else holds it.  Readers never need
+   * it: a delta is only ever replaced whole.
+   *
+   * @return the lock, or -1 if it couldn't be taken.
+   */
+
+  static int lockDelta(const string& directory);
+  static void unlockDelta(int lock);
+
+  /**
+   * Method: getDeltaCreditCount
+   * ---------------------------
+   * Returns the number of credits the applied delta adds, or 0 if there
+   * isn't one.
+   */
+
+  int getDeltaCreditCount() const { return deltaCreditCount; }
+
+  /**
+   * Constant: kDeltaFileName
+   * ------------------------
+   * The name of the delta file within a data directory.
+   */
+
+  static const char *const kDeltaFileName;
+
+  /**
+   * Methods: getCreditRecords
+   *          getCastRecords
+   * ------------------------
+   * Zero-copy equivalents of getCredits and getCast: return a cursor over
+   * the movie records an actor appeared in, or the actor records in a
+   * movie's cast.
+   */
+
+  recordList getCreditRecords(int actor) const;
+  recordList getCastRecords(int movie) const;
+
+  /**
+   * Methods: prefetchCredits
+   *          prefetchCast
+   * ----------------------
+   * Hint that getCreditRecords or getCastRecords is about to be called
+   * on the record: they start loading the start of its list into the
+   * cache and return without waiting, so that a caller about to visit
+   * many records can have all of their cache misses in flight at once.
+   * They never change what any other method returns.
+   */
+
+  void prefetchCredits(int actor) const;
+  void prefetchCast(int movie) const;
+
+  /**
+   * Methods: mapCredits
+   *          mapCast
+   * ----------------
+   * Callback forms of getCredits and getCast: look up the actor or movie
+   * and invoke fn on each of its movie/actor records, in file order.
+   *
+   * @return true if and only if the actor/movie appeared in the database.
+   */
+
+  bool mapCredits(const string& player, RecordMapFunction fn, void *auxData) const;
+  bool mapCast(const film& movie, RecordMapFunction fn, void *auxData) const;
+
   int compActors(const void *first, const void *second);
 
+  /**
+   * Type: searchEntry
+   * -----------------
+   * One node of the optional search index: a record offset together with
+   * the first eight bytes of its name (packed big-endian, so integer order
+   * matches strcmp order) and, for movies, the release year.
+   */
+
+  struct searchEntry {
+    unsigned long long prefix;
+    int offset;
+    int year;
+  };
+
+  /**
+   * Method: writeHashIndex
+   * ----------------------
+   * Writes the optional name index for this imdb's data files into the
+   * specified directory (normally the one it was opened from); compact
+   * imdbs have no use for one, and never write it.  The index
+   * holds open-addressing hash tables from actor name, and from movie title
+   * and year, to record offset.  imdbs opened on that directory afterwards
+   * map it in and answer findActor/findMovie with one or two probes,
+   * falling back to binary search if it's missing or was built for
+   * different data files.
+   *
+   * @param directory the directory the index file should be written to.
+   * @return true if and only if the index was written in full.
+   */
+
+  bool writeHashIndex(const string& directory) const;
+
+  /**
+   * Type: hashSlot
+   * --------------
+   * One slot of a name index table: the full 32-bit hash of the name (so
+   * most mismatches never touch the data files) and the record offset,
+   * or -1 if the slot is empty.
+   */
+
+  struct hashSlot {
+    unsigned int hash;
+    int offset;
+  };
+
+  /**
+   * Method: writeTitleIndex
+   * -----------------------
+   * Writes the optional title index for this imdb's data into the
+   * specified directory: an open-addressing hash table from title alone
+   * to the run of (year, record) entries for the movies of that title.
+   * Unlike the name index it serves compact files too, since records are
+   * whatever handles the opened files use.  imdbs opened on that
+   * directory afterwards map it in for findMovies, and ignore it if it
+   * was built for different data files.
+   *
+   * @param directory the directory the index file should be written to.
+   * @return true if and only if the index was written in full.
+   */
+
+  bool writeTitleIndex(const string& directory) const;
+
+  /**
+   * Types: titleSlot
+   *        titleEntry
+   * -----------------
+   * A title index slot holds the full 32-bit hash of a title and where
+   * its run of entries starts and how long it is; empty slots have a
+   * count of 0.  Each entry is one movie's year and record.
+   */
+
+  struct titleSlot {
+    unsigned int hash;
+    int first;
+    int count;
+  };
+
+  struct titleEntry {
+    int year;
+    int record;
+  };
+
   /**
    * Destructor: ~imdb
    * -----------------
@@ -88,19 +518,87 @@ class imdb {
  private:
   static const char *const kActorFileName;
   static const char *const kMovieFileName;
+  static const char *const kIndexFileName;
+  static const char *const kTitleIndexFileName;
   const void *actorFile;
   const void *movieFile;
+  vector<searchEntry> actorIndex;  // Eytzinger order, 1-based; empty unless kSearchIndex
+  vector<searchEntry> movieIndex;
+  const hashSlot *actorSlots;      // NULL unless a valid name index is mapped
+  const hashSlot *movieSlots;
+  int actorSlotMask;
+  int movieSlotMask;
+  const titleSlot *titleSlots;     // NULL unless a valid title index is mapped
+  const titleEntry *titleEntries;
+  int titleSlotMask;
+  int actorCount;                  // in the data files alone
+  int movieCount;
+
+  // the sections of a compact file; see imdb-compact.h
+  bool compact;
+  struct compactLayout {
+    const unsigned int *actorNames;
+    const unsigned int *movieNames;
+    const signed char *movieYears;
+    const unsigned int *actorLists;
+    const unsigned int *movieLists;
+    const unsigned char *adjacency;
+    const char *heap;
+    const unsigned int *actorOrder;   // NULL unless the file is renumbered
+    const unsigned int *movieOrder;
+  } layout;
+
+  // the tables of an applied delta; see acquireDelta
+  struct deltaLayout {
+    const int *actorNames;          // heap offsets, in name order
+    const int *movieNames;          // heap offsets, in title and year order
+    const int *movieYears;
+    const int *creditActors;        // the credits by actor, then movie
+    const int *creditMovies;
+    const int *castMovies;          // the same credits by movie, then actor
+    const int *castActors;
+    const char *heap;
+  } delta;
+  int deltaActorCount;
+  int deltaMovieCount;
+  int deltaCreditCount;
+  int actorLimit;                  // delta records are numbered up from these,
+  int movieLimit;                  // which are INT_MAX without a delta
+  vector<int> actorPositions;      // where each delta actor falls in name order
+  vector<int> moviePositions;
   
   // everything below here is complicated and needn't be touched.
   // you're free to investigate, but you're on your own.
   struct fileInfo {
     int fd;
     size_t fileSize;
+    size_t mapSize;      // differs from fileSize only for huge page copies
     const void *fileMap;
-  } actorInfo, movieInfo;
+  } actorInfo, movieInfo, indexInfo, titleInfo, deltaInfo, compactInfo;
   
-  static const void *acquireFileMap(const string& fileName, struct fileInfo& info);
+  static const void *acquireFileMap(const string& fileName, struct fileInfo& info, int options = 0);
   static void releaseFileMap(struct fileInfo& info);
+  void acquireHashIndex(const string& fileName);
+  void acquireTitleIndex(const string& fileName);
+  void acquireDelta(const string& fileName);
+
+  size_t getActorBaseSize() const { return compact ? compactInfo.fileSize : actorInfo.fileSize; }
+  size_t getMovieBaseSize() const { return compact ? compactInfo.fileSize : movieInfo.fileSize; }
+  int getBaseActorRecord(int index) const {
+    if (!compact) return ((const int*)actorFile)[index + 1];
+    return layout.actorOrder == NULL ? index : layout.actorOrder[index];
+  }
+  int getBaseMovieRecord(int index) const {
+    if (!compact) return ((const int*)movieFile)[index + 1];
+    return layout.movieOrder == NULL ? index : layout.movieOrder[index];
+  }
+  int getMergedActorRecord(int index) const;
+  int getMergedMovieRecord(int index) const;
+  int findBaseActor(const char *player) const;
+  int findBaseMovie(const char *title, int year) const;
+  recordList getBaseCreditRecords(int actor) const;
+  recordList getBaseCastRecords(int movie) const;
+  bool acquireCompactFile(const string& fileName, int options);
 
   // marked as private so imdbs can't be copy constructed or reassigned.
   // if we were to allow this, we'd alias open files and accidentally close
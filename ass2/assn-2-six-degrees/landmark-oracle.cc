@@ -0,0 +1,163 @@
+#include "landmark-oracle.h"
+#include <algorithm>
+#include <fstream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+using namespace std;
+
+const char *const landmarkOracle::kFileName = "landmarks";
+
+/**
+ * The landmark file is a header identifying the graph, the ids of the
+ * landmarks, and then for each actor in id order one distance byte per
+ * landmark.  Everything is in native byte order.  The header records the
+ * data file sizes and the graph's numbering as well as its counts, since
+ * converting the data can renumber the actors without changing a count.
+ */
+
+struct landmarkFileHeader {
+  int magic;
+  int version;
+  long long actorFileSize;
+  long long movieFileSize;
+  unsigned int numbering;
+  int actorCount;
+  int movieCount;
+  int edgeCount;
+  int landmarkCount;
+};
+
+static const int kLandmarkFileMagic = 0x4b4d444c;  // "LDMK"
+static const int kLandmarkFileVersion = 2;
+
+/**
+ * Orders actors by decreasing number of credits, breaking ties by id so
+ * that the choice of landmarks is deterministic.
+ */
+
+struct byCreditCount {
+  const graph& g;
+  byCreditCount(const graph& g) : g(g) {}
+  bool operator()(int first, int second) const {
+    int firstCount = g.getCreditCount(first), secondCount = g.getCreditCount(second);
+    return firstCount != secondCount ? firstCount > secondCount : first < second;
+  }
+};
+
+static void chooseLandmarks(const graph& g, int count, bool randomly, unsigned int seed,
+                            vector<int>& chosen)
+{
+  vector<int> candidates;
+  for (int actor = 0; actor < g.getActorCount(); actor++)
+    if (g.getCreditCount(actor) > 0) candidates.push_back(actor);
+  count = min(count, (int) candidates.size());
+
+  if (randomly) {
+    for (int i = 0; i < count; i++)
+      swap(candidates[i], candidates[i + rand_r(&seed) % (candidates.size() - i)]);
+  } else {
+    partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), byCreditCount(g));
+  }
+  chosen.assign(candidates.begin(), candidates.begin() + count);
+}
+
+bool landmarkOracle::build(const graph& g, const string& fileName, int count,
+                           bool randomly, unsigned int seed, int numThreads)
+{
+  vector<int> chosen;
+  chooseLandmarks(g, count, randomly, seed, chosen);
+  count = chosen.size();
+
+  vector<unsigned char> table((size_t) g.getActorCount() * count);
+  for (int i = 0; i < count; i++) {
+    bfsTree tree;
+    breadthFirstSearch(g, chosen[i], tree, false, numThreads);
+    for (int actor = 0; actor < g.getActorCount(); actor++)
+      table[(size_t) actor * count + i] = tree.distance[actor];
+  }
+
+  landmarkFileHeader header;
+  header.magic = kLandmarkFileMagic;
+  header.version = kLandmarkFileVersion;
+  header.actorFileSize = g.getDatabase().getActorFileSize();
+  header.movieFileSize = g.getDatabase().getMovieFileSize();
+  header.numbering = g.getNumbering();
+  header.actorCount = g.getActorCount();
+  header.movieCount = g.getMovieCount();
+  header.edgeCount = g.getEdgeCount();
+  header.landmarkCount = count;
+
+  ofstream outfile(fileName.c_str(), ios::out | ios::binary | ios::trunc);
+  outfile.write((const char *) &header, sizeof(header));
+  if (count > 0) {
+    outfile.write((const char *) &chosen[0], count * sizeof(int));
+    outfile.write((const char *) &table[0], table.size());
+  }
+  outfile.close();
+  return !outfile.fail();
+}
+
+landmarkOracle::landmarkOracle(const graph& g, const string& fileName) :
+  count(0), distances(NULL), fd(-1), fileSize(0), fileMap(NULL)
+{
+  struct stat stats;
+  fd = open(fileName.c_str(), O_RDONLY);
+  if (fd == -1) return;
+  if (fstat(fd, &stats) != 0 || stats.st_size < (off_t) sizeof(landmarkFileHeader)) return;
+  fileSize = stats.st_size;
+  void *map = mmap(0, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) return;
+  fileMap = map;
+
+  const landmarkFileHeader *header = (const landmarkFileHeader *) fileMap;
+  if (header->magic != kLandmarkFileMagic || header->version != kLandmarkFileVersion ||
+      header->actorFileSize != (long long) g.getDatabase().getActorFileSize() ||
+      header->movieFileSize != (long long) g.getDatabase().getMovieFileSize() ||
+      header->numbering != g.getNumbering() ||
+      header->actorCount != g.getActorCount() || header->movieCount != g.getMovieCount() ||
+      header->edgeCount != g.getEdgeCount() || header->landmarkCount <= 0 ||
+      fileSize != sizeof(landmarkFileHeader) + header->landmarkCount * sizeof(int) +
+                  (size_t) header->actorCount * header->landmarkCount) return;
+
+  count = header->landmarkCount;
+  distances = (const unsigned char *) (header + 1) + count * sizeof(int);
+}
+
+landmarkOracle::~landmarkOracle()
+{
+  if (fileMap != NULL) munmap((char *) fileMap, fileSize);
+  if (fd != -1) close(fd);
+}
+
+void landmarkOracle::getBounds(int source, int target, int& lower, int& upper) const
+{
+  const unsigned char *from = distances + (size_t) source * count;
+  const unsigned char *to = distances + (size_t) target * count;
+  lower = source == target ? 0 : 1;
+  upper = source == target ? 0 : kUnreachable;
+  for (int i = 0; i < count; i++) {
+    if ((from[i] == kUnreachable) != (to[i] == kUnreachable)) {
+      lower = upper = kUnreachable;    // one side is in the landmark's component, the other isn't
+      return;
+    }
+    if (from[i] == kUnreachable) continue;
+    lower = max(lower, abs(from[i] - to[i]));
+    upper = min(upper, from[i] + to[i]);
+  }
+}
+
+int landmarkOracle::getLowerBound(int source, int target) const
+{
+  const unsigned char *from = distances + (size_t) source * count;
+  const unsigned char *to = distances + (size_t) target * count;
+  int lower = 0;
+  for (int i = 0; i < count; i++) {
+    if ((from[i] == kUnreachable) != (to[i] == kUnreachable)) return kUnreachable;
+    if (from[i] != kUnreachable) lower = max(lower, abs(from[i] - to[i]));
+  }
+  return lower;
+}
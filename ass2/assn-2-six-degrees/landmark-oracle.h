@@ -0,0 +1,112 @@
+#ifndef __landmark_oracle__
+#define __landmark_oracle__
+
+#include "bfs.h"
+#include <string>
+using namespace std;
+
+/**
+ * Class: landmarkOracle
+ * ---------------------
+ * Answers distance bounds between any two actors in O(k), using distances
+ * precomputed from k landmark actors.  For every landmark L, the triangle
+ * inequality gives
+ *
+ *     |d(L, s) - d(L, t)| <= d(s, t) <= d(L, s) + d(L, t),
+ *
+ * and if L reaches exactly one of s and t, they can't be connected at all.
+ *
+ * The distances live in a sidecar file (see build) that is mapped in
+ * read-only.  They're stored actor-major, one byte per landmark, so the
+ * k distances for an actor usually share a single cache line.
+ */
+
+class landmarkOracle {
+
+ public:
+
+  /**
+   * Constant: kFileName
+   * -------------------
+   * The name of the landmark file within a data directory.
+   */
+
+  static const char *const kFileName;
+
+  /**
+   * Static Method: build
+   * --------------------
+   * Chooses landmarks, searches the whole graph from each one and writes
+   * the results to the specified file.
+   *
+   * @param g the graph to compute distances over.
+   * @param fileName the file to write.
+   * @param count the number of landmarks to use.
+   * @param randomly true to pick landmarks at random (from actors with at
+   *                 least one credit), or false to pick the actors with
+   *                 the most credits.
+   * @param seed the random seed, if randomly is true.
+   * @param numThreads the number of threads each search may use.
+   * @return true if and only if the file was written in full.
+   */
+
+  static bool build(const graph& g, const string& fileName, int count,
+                    bool randomly, unsigned int seed, int numThreads);
+
+  /**
+   * Constructor: landmarkOracle
+   * ---------------------------
+   * Maps in the specified landmark file, which must have been built for
+   * the specified graph.
+   */
+
+  landmarkOracle(const graph& g, const string& fileName);
+  ~landmarkOracle();
+
+  /**
+   * Predicate Method: good
+   * ----------------------
+   * Returns true if and only if the file exists and was built from
+   * the same data as the graph.
+   */
+
+  bool good() const { return distances != NULL; }
+
+  int getLandmarkCount() const { return count; }
+
+  /**
+   * Method: getBounds
+   * -----------------
+   * Computes bounds on the number of movies separating two actors.
+   * kUnreachable stands for infinity in both bounds: a lower bound of
+   * kUnreachable proves that there's no path, and an upper bound of
+   * kUnreachable means no landmark reaches both actors.
+   *
+   * @param source the id of the first actor.
+   * @param target the id of the second actor.
+   * @param lower updated with the lower bound.
+   * @param upper updated with the upper bound.
+   */
+
+  void getBounds(int source, int target, int& lower, int& upper) const;
+
+  /**
+   * Method: getLowerBound
+   * ---------------------
+   * The lower bound half of getBounds, for pruning searches.
+   */
+
+  int getLowerBound(int source, int target) const;
+
+ private:
+  int count;
+  const unsigned char *distances;   // count bytes per actor
+  int fd;
+  size_t fileSize;
+  const void *fileMap;
+
+  landmarkOracle(const landmarkOracle& original);
+  landmarkOracle& operator=(const landmarkOracle& rhs);
+};
+
+#endif
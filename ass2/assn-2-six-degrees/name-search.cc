@@ -0,0 +1,117 @@
+#include "name-search.h"
+#include <algorithm>
+#include <ctype.h>
+#include <string.h>
+using namespace std;
+
+void nameSearch::complete(const string& prefix, int limit, vector<string>& names) const
+{
+  names.clear();
+  int low = 0, high = db.getActorCount();
+  while (low < high) {                      // first name not less than the prefix
+    int mid = low + (high - low) / 2;
+    if (strcmp(db.getActorName(db.getActorRecord(mid)), prefix.c_str()) < 0) low = mid + 1;
+    else high = mid;
+  }
+  for (int i = low; i < db.getActorCount() && (int) names.size() < limit; i++) {
+    const char *name = db.getActorName(db.getActorRecord(i));
+    if (strncmp(name, prefix.c_str(), prefix.size()) != 0) break;
+    names.push_back(name);
+  }
+}
+
+// returns the index just past the run of names, starting at first, that
+// share the length-byte prefix; gallops first since most runs are short
+int nameSearch::findEndOfPrefix(int first, const char *prefix, int length) const
+{
+  int count = db.getActorCount();
+  int low = first + 1, step = 1;
+  while (low < count && strncmp(db.getActorName(db.getActorRecord(low)), prefix, length) == 0) {
+    first = low;
+    low += step;
+    step *= 2;
+  }
+  int high = min(low, count);
+  low = first + 1;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (strncmp(db.getActorName(db.getActorRecord(mid)), prefix, length) == 0) low = mid + 1;
+    else high = mid;
+  }
+  return low;
+}
+
+/**
+ * Method: findMatches
+ * -------------------
+ * Computes edit distances with the usual dynamic program, one row per
+ * character of the candidate name.  Row j depends only on the first j
+ * characters, so rows are kept for as long as successive names share
+ * them, and once every entry in a row exceeds maxDistance no name under
+ * that prefix can match, so the whole run is skipped.
+ */
+
+void nameSearch::findMatches(const string& name, int maxDistance, vector<match>& matches) const
+{
+  int width = name.size() + 1;
+  vector<int> rows(width);
+  for (int x = 0; x < width; x++) rows[x] = x;
+  vector<char> query(name.size());
+  for (int x = 0; x < (int) name.size(); x++) query[x] = tolower((unsigned char) name[x]);
+
+  const char *previous = "";
+  int depth = 0;                            // rows 0 through depth match previous
+  int count = db.getActorCount();
+  for (int i = 0; i < count;) {
+    const char *candidate = db.getActorName(db.getActorRecord(i));
+    while (depth > 0 && strncmp(candidate, previous, depth) != 0) depth--;
+    previous = candidate;
+
+    bool pruned = false;
+    for (; candidate[depth] != '\0'; depth++) {
+      if ((int) rows.size() < (depth + 2) * width) rows.resize((depth + 2) * width);
+      const int *above = &rows[depth * width];
+      int *row = &rows[(depth + 1) * width];
+      char c = tolower((unsigned char) candidate[depth]);
+      row[0] = depth + 1;
+      int best = row[0];
+      for (int x = 1; x < width; x++) {
+        row[x] = min(min(above[x], row[x - 1]) + 1, above[x - 1] + (query[x - 1] != c));
+        best = min(best, row[x]);
+      }
+      if (best > maxDistance) {
+        i = findEndOfPrefix(i, candidate, depth + 1);
+        pruned = true;
+        break;
+      }
+    }
+    if (pruned) continue;
+
+    int distance = rows[depth * width + width - 1];
+    if (distance <= maxDistance) {
+      match found = { distance, i };
+      matches.push_back(found);
+    }
+    i++;
+  }
+  sort(matches.begin(), matches.end());
+}
+
+void nameSearch::suggest(const string& name, int maxDistance, int limit, vector<string>& names) const
+{
+  names.clear();
+  vector<match> matches;
+  findMatches(name, maxDistance, matches);
+  for (int i = 0; i < (int) matches.size() && (int) names.size() < limit; i++)
+    names.push_back(db.getActorName(db.getActorRecord(matches[i].index)));
+}
+
+string nameSearch::resolve(const string& name, int maxDistance) const
+{
+  if (db.findActor(name.c_str()) != -1) return name;
+  vector<match> matches;
+  findMatches(name, maxDistance, matches);
+  if (matches.empty() || (matches.size() > 1 && matches[1].distance == matches[0].distance))
+    return "";
+  return db.getActorName(db.getActorRecord(matches[0].index));
+}
@@ -0,0 +1,90 @@
+#ifndef __name_search__
+#define __name_search__
+
+#include "imdb.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: nameSearch
+ * -----------------
+ * Inexact lookups of actor names: completions of a prefix, and
+ * "did you mean" suggestions within a few typos of a name.
+ *
+ * The index is the sorted offset array at the front of the actor file,
+ * which already behaves like a trie: names sharing a prefix are adjacent,
+ * so a prefix is one binary search away, and the edit-distance search
+ * walks the names in order, reusing the work done on the prefix a name
+ * shares with the one before it and skipping every name under a prefix
+ * that's already too far from the query.  Nothing is built or copied.
+ */
+
+class nameSearch {
+
+ public:
+
+  /**
+   * Constructor: nameSearch
+   * -----------------------
+   * Constructs a search over the actors in the specified imdb, which
+   * must outlive it.
+   */
+
+  nameSearch(const imdb& db) : db(db) {}
+
+  /**
+   * Method: complete
+   * ----------------
+   * Finds the actors whose names start with the specified prefix, in
+   * sorted order.  Matching is exact, case included.
+   *
+   * @param prefix the start of the name.
+   * @param limit the most names to return.
+   * @param names updated with the matching names.
+   */
+
+  void complete(const string& prefix, int limit, vector<string>& names) const;
+
+  /**
+   * Method: suggest
+   * ---------------
+   * Finds the actors whose names are within maxDistance single-character
+   * insertions, deletions and substitutions of the specified name,
+   * ignoring case, closest first and then in sorted order.
+   *
+   * @param name the name, possibly misspelled.
+   * @param maxDistance the most edits a suggestion may be from the name.
+   * @param limit the most names to return.
+   * @param names updated with the suggestions.
+   */
+
+  void suggest(const string& name, int maxDistance, int limit, vector<string>& names) const;
+
+  /**
+   * Method: resolve
+   * ---------------
+   * Returns the name itself if there's such an actor, or else the one
+   * closest suggestion within maxDistance edits, for matching names from
+   * other sources automatically.  Returns the empty string if there's no
+   * suggestion, or if several are equally close.
+   */
+
+  string resolve(const string& name, int maxDistance) const;
+
+ private:
+  struct match {
+    int distance;
+    int index;
+    bool operator<(const match& other) const {
+      return distance != other.distance ? distance < other.distance : index < other.index;
+    }
+  };
+
+  const imdb& db;
+
+  int findEndOfPrefix(int first, const char *prefix, int length) const;
+  void findMatches(const string& name, int maxDistance, vector<match>& matches) const;
+};
+
+#endif
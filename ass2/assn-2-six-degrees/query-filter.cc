@@ -0,0 +1,115 @@
+#include "query-filter.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdlib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+typedef unsigned long long maskWord;
+
+void buildRangeMask(const signed char *bytes, int count, signed char low, signed char high,
+                    vector<maskWord>& mask)
+{
+  mask.assign((count + 63) / 64, 0);
+  int i = 0;
+#ifdef __SSE2__
+  const __m128i lows = _mm_set1_epi8(low), highs = _mm_set1_epi8(high);
+  for (; i + 64 <= count; i += 64) {
+    maskWord word = 0;
+    for (int part = 0; part < 4; part++) {
+      __m128i chunk = _mm_loadu_si128((const __m128i *) (bytes + i + 16 * part));
+      __m128i outside = _mm_or_si128(_mm_cmplt_epi8(chunk, lows), _mm_cmpgt_epi8(chunk, highs));
+      maskWord inside = ~_mm_movemask_epi8(outside) & 0xffff;
+      word |= inside << (16 * part);
+    }
+    mask[i / 64] = word;
+  }
+#endif
+  for (; i < count; i++)
+    if (bytes[i] >= low && bytes[i] <= high) mask[i / 64] |= (maskWord) 1 << (i % 64);
+}
+
+// sets the first count bits, and clears the rest of the last word
+static void fillMask(vector<maskWord>& mask, int count)
+{
+  mask.assign((count + 63) / 64, ~(maskWord) 0);
+  if (count % 64 != 0) mask.back() = ((maskWord) 1 << (count % 64)) - 1;
+}
+
+queryFilter::queryFilter(const graph& g) : g(g), restrictive(false)
+{
+  const imdb& db = g.getDatabase();
+  years.resize(g.getMovieCount());
+  for (int movie = 0; movie < g.getMovieCount(); movie++)
+    years[movie] = db.getMovieYear(g.getMovieRecord(movie)) - 1900;
+  fillMask(yearMask, g.getMovieCount());
+  excludedMovies.assign(yearMask.size(), 0);
+  allowedMovies = yearMask;
+  fillMask(allowedActors, g.getActorCount());
+}
+
+void queryFilter::setYearRange(int firstYear, int lastYear)
+{
+  restrictive = true;
+  if (firstYear > lastYear || lastYear < 1900 - 128 || firstYear > 1900 + 127) {
+    yearMask.assign(yearMask.size(), 0);
+  } else {
+    int low = max(firstYear - 1900, -128), high = min(lastYear - 1900, 127);
+    buildRangeMask(years.empty() ? NULL : &years[0], years.size(), low, high, yearMask);
+  }
+  updateAllowedMovies();
+}
+
+void queryFilter::updateAllowedMovies()
+{
+  for (int i = 0; i < (int) allowedMovies.size(); i++)
+    allowedMovies[i] = yearMask[i] & ~excludedMovies[i];
+}
+
+bool queryFilter::excludeMovie(const film& movie)
+{
+  int id = g.getMovieId(movie);
+  if (id == -1) return false;
+  restrictive = true;
+  excludedMovies[id >> 6] |= (maskWord) 1 << (id & 63);
+  allowedMovies[id >> 6] &= ~((maskWord) 1 << (id & 63));
+  return true;
+}
+
+bool queryFilter::excludeActor(const string& player)
+{
+  int id = g.getActorId(player);
+  if (id == -1) return false;
+  restrictive = true;
+  allowedActors[id >> 6] &= ~((maskWord) 1 << (id & 63));
+  return true;
+}
+
+bool queryFilter::excludeFromFile(const string& fileName, bool movies)
+{
+  ifstream infile(fileName.c_str());
+  if (infile.fail()) return false;
+  int lineNumber = 0;
+  string line;
+  while (getline(infile, line)) {
+    lineNumber++;
+    if (line == "") continue;
+    bool found;
+    if (movies) {
+      size_t tab = line.find('\t');
+      film movie;
+      movie.title = line.substr(0, tab);
+      movie.year = tab == string::npos ? 0 : atoi(line.c_str() + tab + 1);
+      found = tab != string::npos && excludeMovie(movie);
+    } else {
+      found = excludeActor(line);
+    }
+    if (!found)
+      cerr << fileName << ":" << lineNumber << ": no such " << (movies ? "movie" : "actor")
+           << " as \"" << line << "\"; ignoring it." << endl;
+  }
+  return true;
+}
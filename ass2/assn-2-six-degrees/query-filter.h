@@ -0,0 +1,114 @@
+#ifndef __query_filter__
+#define __query_filter__
+
+#include "graph.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * Class: queryFilter
+ * ------------------
+ * Restricts path queries to a subgraph: only movies released within a
+ * range of years, and none of a set of excluded movies and actors.  The
+ * restrictions are precomputed as one bit per movie id and one bit per
+ * actor id, so a search tests them in its inner loop with a shift and a
+ * mask, and a path through a filtered-out movie or actor is never found
+ * in the first place (rather than found and then thrown away, which can
+ * hide a longer path that does qualify).
+ *
+ * A filter that excludes nothing allows everything, and a search can
+ * take a NULL filter to mean the same thing.
+ */
+
+class queryFilter {
+
+ public:
+
+  /**
+   * Constructor: queryFilter
+   * ------------------------
+   * Creates a filter over the specified graph that allows every movie
+   * and every actor.
+   *
+   * @param g the graph whose ids the filter is over; it must outlive it.
+   */
+
+  queryFilter(const graph& g);
+
+  /**
+   * Method: setYearRange
+   * --------------------
+   * Allows only movies released from firstYear to lastYear, inclusive,
+   * in addition to any exclusions.  Calling it again replaces the range.
+   */
+
+  void setYearRange(int firstYear, int lastYear);
+
+  /**
+   * Methods: excludeMovie
+   *          excludeActor
+   * ---------------------
+   * Rule out a single movie or actor.
+   *
+   * @return false if and only if there's no such movie or actor.
+   */
+
+  bool excludeMovie(const film& movie);
+  bool excludeActor(const string& player);
+
+  /**
+   * Method: excludeFromFile
+   * -----------------------
+   * Excludes every movie or actor listed in the named file, one per line.
+   * Actors are listed by name; movies by title, a tab and the year.
+   * Lines naming something that isn't in the graph are reported on cerr
+   * and skipped.
+   *
+   * @param fileName the file to read.
+   * @param movies true if the file lists movies, false if actors.
+   * @return false if and only if the file couldn't be read.
+   */
+
+  bool excludeFromFile(const string& fileName, bool movies);
+
+  /**
+   * Predicate Methods: allowsMovie
+   *                    allowsActor
+   *                    isRestrictive
+   * --------------------------------
+   * Report whether the movie or actor (by graph id) may appear in a path,
+   * and whether the filter rules anything out at all.
+   */
+
+  bool allowsMovie(int movie) const { return (allowedMovies[movie >> 6] >> (movie & 63)) & 1; }
+  bool allowsActor(int actor) const { return (allowedActors[actor >> 6] >> (actor & 63)) & 1; }
+  bool isRestrictive() const { return restrictive; }
+
+ private:
+  const graph& g;
+  vector<signed char> years;             // per movie id, less 1900, as the data files store them
+  vector<unsigned long long> yearMask;   // movies in the year range
+  vector<unsigned long long> excludedMovies;
+  vector<unsigned long long> allowedMovies;   // yearMask less excludedMovies
+  vector<unsigned long long> allowedActors;
+  bool restrictive;
+
+  void updateAllowedMovies();
+};
+
+/**
+ * Function: buildRangeMask
+ * ------------------------
+ * Sets bit i of mask, for each of the count bytes, if and only if
+ * low <= bytes[i] <= high.  The bits are packed 64 to a word, with any
+ * bits past count cleared.  With SSE2 it compares sixteen bytes at a
+ * time and gathers the results with a movemask.
+ *
+ * @param mask resized to fit the bits.
+ */
+
+void buildRangeMask(const signed char *bytes, int count, signed char low, signed char high,
+                    vector<unsigned long long>& mask);
+
+#endif
@@ -0,0 +1,341 @@
+#include "query-server.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace std;
+
+static const int kMaxInFlight = 64;      // pipelined requests per connection
+static const int kPollMilliseconds = 250;
+static const int kReadSize = 65536;
+
+/**
+ * Type: connection
+ * ----------------
+ * One client.  Requests are numbered as they're read, and answers wait
+ * in ready until every earlier answer has been written.  The reader
+ * thread and every queued or running request hold a reference, and the
+ * last one to let go closes the socket.
+ */
+
+struct connection {
+  int fd;
+  pthread_mutex_t lock;
+  pthread_cond_t windowOpen;           // signaled as answers are written
+  long long received;
+  long long sent;
+  map<long long, string> ready;
+  int references;
+  bool broken;                         // a write failed, or the server is stopping
+};
+
+struct job {
+  connection *client;
+  long long sequence;
+  string request;
+};
+
+/**
+ * Type: serverState
+ * -----------------
+ * What the accept loop, the readers and the workers share, all guarded
+ * by lock.
+ */
+
+struct serverState {
+  requestHandler handler;
+  void *auxData;
+  pthread_mutex_t lock;
+  pthread_cond_t jobsWaiting;
+  pthread_cond_t connectionClosed;
+  deque<job> jobs;
+  set<connection *> connections;
+  bool stopping;
+};
+
+struct readerArgs {
+  serverState *server;
+  connection *client;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int signal)
+{
+  stopRequested = 1;
+}
+
+static void releaseConnection(serverState *server, connection *client)
+{
+  pthread_mutex_lock(&client->lock);
+  bool last = --client->references == 0;
+  pthread_mutex_unlock(&client->lock);
+  if (!last) return;
+
+  pthread_mutex_lock(&server->lock);
+  server->connections.erase(client);
+  pthread_cond_broadcast(&server->connectionClosed);
+  pthread_mutex_unlock(&server->lock);
+  close(client->fd);
+  pthread_mutex_destroy(&client->lock);
+  pthread_cond_destroy(&client->windowOpen);
+  delete client;
+}
+
+static bool writeAll(int fd, const string& text)
+{
+  size_t written = 0;
+  while (written < text.size()) {
+    ssize_t count = send(fd, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    written += count;
+  }
+  return true;
+}
+
+/**
+ * Function: deliver
+ * -----------------
+ * Files an answer and writes out every answer that's now next in line.
+ */
+
+static void deliver(connection *client, long long sequence, const string& answer)
+{
+  pthread_mutex_lock(&client->lock);
+  client->ready[sequence] = answer;
+  while (!client->ready.empty() && client->ready.begin()->first == client->sent) {
+    if (!client->broken && !writeAll(client->fd, client->ready.begin()->second))
+      client->broken = true;
+    client->ready.erase(client->ready.begin());
+    client->sent++;
+  }
+  pthread_cond_broadcast(&client->windowOpen);
+  pthread_mutex_unlock(&client->lock);
+}
+
+static void *runWorker(void *arg)
+{
+  serverState *server = (serverState *) arg;
+  while (true) {
+    pthread_mutex_lock(&server->lock);
+    while (server->jobs.empty() && !server->stopping)
+      pthread_cond_wait(&server->jobsWaiting, &server->lock);
+    if (server->stopping) {
+      // nothing is queued once stopping is set, so whoever gets here first drains it all
+      deque<job> abandoned;
+      abandoned.swap(server->jobs);
+      pthread_mutex_unlock(&server->lock);
+      for (int i = 0; i < (int) abandoned.size(); i++) releaseConnection(server, abandoned[i].client);
+      return NULL;
+    }
+    job next = server->jobs.front();
+    server->jobs.pop_front();
+    pthread_mutex_unlock(&server->lock);
+
+    deliver(next.client, next.sequence, server->handler(next.request, server->auxData));
+    releaseConnection(server, next.client);
+  }
+}
+
+/**
+ * Function: enqueue
+ * -----------------
+ * Waits for room in the connection's window, then queues the request.
+ *
+ * @return false if the connection or the server is shutting down.
+ */
+
+static bool enqueue(serverState *server, connection *client, const string& request)
+{
+  pthread_mutex_lock(&client->lock);
+  while (!client->broken && client->received - client->sent >= kMaxInFlight)
+    pthread_cond_wait(&client->windowOpen, &client->lock);
+  bool broken = client->broken;
+  job added = { client, client->received++, request };
+  if (!broken) client->references++;
+  pthread_mutex_unlock(&client->lock);
+  if (broken) return false;
+
+  pthread_mutex_lock(&server->lock);
+  bool stopping = server->stopping;
+  if (!stopping) {
+    server->jobs.push_back(added);
+    pthread_cond_signal(&server->jobsWaiting);
+  }
+  pthread_mutex_unlock(&server->lock);
+  if (stopping) releaseConnection(server, client);
+  return !stopping;
+}
+
+/**
+ * Function: readRequests
+ * ----------------------
+ * The thread behind each connection: splits what the client sends into
+ * lines and queues each nonempty one, until the client hangs up.
+ */
+
+static void *readRequests(void *arg)
+{
+  readerArgs *args = (readerArgs *) arg;
+  serverState *server = args->server;
+  connection *client = args->client;
+  delete args;
+
+  vector<char> buffer(kReadSize);
+  string pending;
+  bool open = true;
+  while (open) {
+    ssize_t count = read(client->fd, &buffer[0], buffer.size());
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) break;
+    pending.append(&buffer[0], count);
+    size_t start = 0, newline;
+    while (open && (newline = pending.find('\n', start)) != string::npos) {
+      string line = pending.substr(start, newline - start);
+      start = newline + 1;
+      if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+      if (!line.empty()) open = enqueue(server, client, line);
+    }
+    pending.erase(0, start);
+  }
+  releaseConnection(server, client);
+  return NULL;
+}
+
+static int listenOn(const string& socketPath)
+{
+  struct sockaddr_un address;
+  if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socketPath.c_str());
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1) return -1;
+  unlink(socketPath.c_str());
+  if (bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Function: acceptConnection
+ * --------------------------
+ * Registers a new client and starts its reader thread.
+ */
+
+static void acceptConnection(serverState *server, int fd)
+{
+  connection *client = new connection;
+  client->fd = fd;
+  pthread_mutex_init(&client->lock, NULL);
+  pthread_cond_init(&client->windowOpen, NULL);
+  client->received = client->sent = 0;
+  client->references = 1;
+  client->broken = false;
+  pthread_mutex_lock(&server->lock);
+  server->connections.insert(client);
+  pthread_mutex_unlock(&server->lock);
+
+  readerArgs *args = new readerArgs;
+  args->server = server;
+  args->client = client;
+  pthread_attr_t attributes;
+  pthread_attr_init(&attributes);
+  pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+  pthread_t thread;
+  if (pthread_create(&thread, &attributes, readRequests, args) != 0) {
+    delete args;
+    releaseConnection(server, client);
+  }
+  pthread_attr_destroy(&attributes);
+}
+
+/**
+ * Function: stopServing
+ * ---------------------
+ * Stops the workers, which drop any requests still queued, then hangs up
+ * on every client and waits for their readers to finish.
+ */
+
+static void stopServing(serverState *server, vector<pthread_t>& workers)
+{
+  pthread_mutex_lock(&server->lock);
+  server->stopping = true;
+  pthread_cond_broadcast(&server->jobsWaiting);
+  // shutting down first unblocks any worker stuck writing to a client that stopped reading
+  set<connection *>::iterator client;
+  for (client = server->connections.begin(); client != server->connections.end(); client++)
+    shutdown((*client)->fd, SHUT_RDWR);
+  for (client = server->connections.begin(); client != server->connections.end(); client++) {
+    pthread_mutex_lock(&(*client)->lock);
+    (*client)->broken = true;
+    pthread_cond_broadcast(&(*client)->windowOpen);
+    pthread_mutex_unlock(&(*client)->lock);
+  }
+  pthread_mutex_unlock(&server->lock);
+
+  for (int i = 0; i < (int) workers.size(); i++) pthread_join(workers[i], NULL);
+  pthread_mutex_lock(&server->lock);
+  while (!server->connections.empty())
+    pthread_cond_wait(&server->connectionClosed, &server->lock);
+  pthread_mutex_unlock(&server->lock);
+}
+
+bool serveRequests(const string& socketPath, int numThreads, requestHandler handler,
+                   void *auxData)
+{
+  int listener = listenOn(socketPath);
+  if (listener == -1) return false;
+
+  serverState server;
+  server.handler = handler;
+  server.auxData = auxData;
+  server.stopping = false;
+  pthread_mutex_init(&server.lock, NULL);
+  pthread_cond_init(&server.jobsWaiting, NULL);
+  pthread_cond_init(&server.connectionClosed, NULL);
+  vector<pthread_t> workers;
+  for (int i = 0; i < max(numThreads, 1); i++) {
+    pthread_t worker;
+    if (pthread_create(&worker, NULL, runWorker, &server) == 0) workers.push_back(worker);
+  }
+
+  stopRequested = 0;
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = requestStop;
+  struct sigaction previousInterrupt, previousTerminate;
+  sigaction(SIGINT, &action, &previousInterrupt);
+  sigaction(SIGTERM, &action, &previousTerminate);
+
+  // poll with a timeout, since the signal may land on some other thread
+  struct pollfd waiting = { listener, POLLIN, 0 };
+  while (!stopRequested && !workers.empty()) {
+    if (poll(&waiting, 1, kPollMilliseconds) <= 0) continue;
+    int fd = accept(listener, NULL, NULL);
+    if (fd != -1) acceptConnection(&server, fd);
+  }
+
+  sigaction(SIGINT, &previousInterrupt, NULL);
+  sigaction(SIGTERM, &previousTerminate, NULL);
+  close(listener);
+  unlink(socketPath.c_str());
+  stopServing(&server, workers);
+  pthread_cond_destroy(&server.connectionClosed);
+  pthread_cond_destroy(&server.jobsWaiting);
+  pthread_mutex_destroy(&server.lock);
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef __query_server__
+#define __query_server__
+
+#include <string>
+using namespace std;
+
+/**
+ * Type: requestHandler
+ * --------------------
+ * Answers one request line (without its newline) with the full text of
+ * the response.  Handlers are called from several threads at once, so
+ * anything they share through auxData must be safe to read concurrently.
+ */
+
+typedef string (*requestHandler)(const string& request, void *auxData);
+
+/**
+ * Function: serveRequests
+ * -----------------------
+ * Listens on a Unix domain socket at the specified path (replacing any
+ * stale socket there) and answers requests from any number of clients
+ * until the process is sent SIGINT or SIGTERM, at which point the socket
+ * is removed and the function returns.
+ *
+ * Requests are lines of text.  Each client connection gets a thread that
+ * reads its requests and queues them for a pool of numThreads workers,
+ * so a client may pipeline many requests without waiting for answers,
+ * and requests from one client can be answered in parallel.  Responses
+ * are always written back in the order the requests arrived, each in one
+ * piece.  A connection may have a bounded number of requests in flight;
+ * past that, its requests are read only as earlier ones are answered.
+ *
+ * @param socketPath where to create the socket.
+ * @param numThreads the number of worker threads.
+ * @param handler called to answer each request.
+ * @param auxData passed through to the handler.
+ * @return false if the socket couldn't be set up, and true once the
+ *         server has been told to stop.
+ */
+
+bool serveRequests(const string& socketPath, int numThreads, requestHandler handler,
+                   void *auxData);
+
+#endif
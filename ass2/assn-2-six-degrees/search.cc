@@ -0,0 +1,214 @@
+#include "search.h"
+#include <map>
+#include <set>
+#include <algorithm>
+using namespace std;
+
+/**
+ * Type: predecessor
+ * -----------------
+ * Compact record of how the breadth-first search first reached an
+ * actor: the index of the actor it was reached from and the movie
+ * record the two share.  The source actor is recorded as its own
+ * parent, and only the winning path is ever materialized as a path.
+ */
+
+struct predecessor {
+  int parent;
+  int movie;
+};
+
+// frontier actors whose credits are prefetched together, and how far the
+// cast prefetches run ahead of the casts being read
+static const int kPrefetchBatch = 16;
+
+// per-entry cost of a set or map, beyond the entry itself: three links and a color
+static const int kTreeNodeOverhead = 4 * sizeof(void *);
+
+void searchStats::startLevel(long long frontierSize)
+{
+  peakFrontier = max(peakFrontier, frontierSize);
+  clock_gettime(CLOCK_MONOTONIC, &levelStart);
+}
+
+void searchStats::endLevel()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  levelMilliseconds.push_back((now.tv_sec - levelStart.tv_sec) * 1e3 +
+                              (now.tv_nsec - levelStart.tv_nsec) / 1e6);
+}
+
+/**
+ * Function: buildPath
+ * -------------------
+ * Walks the predecessor records back from the specified actor to the
+ * source of the search and replays the connections in forward order.
+ * This is the only place the search turns records into strings.
+ */
+
+static path buildPath(int actor, const vector<predecessor>& links,
+                      const vector<int>& actors, const imdb& db)
+{
+  vector<int> chain;
+  for (int cur = actor; links[cur].parent != cur; cur = links[cur].parent)
+    chain.push_back(cur);
+
+  path p(db.getActorName(actors[0]));
+  for (int i = (int) chain.size() - 1; i >= 0; i--) {
+    int movie = links[chain[i]].movie;
+    film connection;
+    connection.title = db.getMovieTitle(movie);
+    connection.year = db.getMovieYear(movie);
+    p.addConnection(connection, db.getActorName(actors[chain[i]]));
+  }
+  return p;
+}
+
+/**
+ * Breadth-first search from source to target over the actor/movie graph,
+ * one level at a time, giving up after maxDegrees movies.  The search
+ * works purely on record offsets: credits and casts are read in place
+ * through the imdb's record views, the frontier carries actor indices,
+ * and each discovered actor costs a single predecessor record.
+ *
+ * Records sit at scattered offsets in the mapped files, so nearly every
+ * list read starts with a cache miss.  The frontier is expanded a batch
+ * of actors at a time: their credits are all prefetched before any is
+ * read, and the new movies they lead to are queued and their casts
+ * prefetched a batch ahead of being read, so the misses overlap rather
+ * than being waited out one by one.  Movies and actors are still
+ * reached in the same order as a one-at-a-time expansion, so the path
+ * found is the same.
+ */
+
+bool findShortestPath(const imdb& db, const string& source, const string& target, path& result,
+                      int maxDegrees, searchStats *stats)
+{
+  searchStats local;
+  if (stats == NULL) stats = &local;
+  stats->method = "imdb";
+  int targetRecord = db.findActor(target.c_str());
+  map<int, int> actorIds;
+  set<int> seenFilms;
+  vector<int> actors;
+  vector<predecessor> links;
+
+  predecessor root = { 0, -1 };
+  actors.push_back(db.findActor(source.c_str()));
+  actorIds[actors[0]] = 0;
+  links.push_back(root);
+
+  bool found = false;
+  vector<int> frontier(1, 0), next;
+  vector<predecessor> movies;    // new movies from the current batch, with the actor that led to each
+  for (int depth = 0; depth < maxDegrees && !frontier.empty() && !found; depth++) {
+    stats->startLevel(frontier.size());
+    next.clear();
+    for (int begin = 0; begin < (int) frontier.size() && !found; begin += kPrefetchBatch) {
+      int end = min(begin + kPrefetchBatch, (int) frontier.size());
+      for (int f = begin; f < end; f++) db.prefetchCredits(actors[frontier[f]]);
+      movies.clear();
+      for (int f = begin; f < end; f++) {
+        recordList credits = db.getCreditRecords(actors[frontier[f]]);
+        stats->nodesExpanded++;
+        stats->creditLookups++;
+        for (int movie; credits.next(movie);) {
+          if (!seenFilms.insert(movie).second) continue;
+          predecessor link = { frontier[f], movie };
+          if ((int) movies.size() < kPrefetchBatch) db.prefetchCast(movie);
+          movies.push_back(link);
+        }
+      }
+
+      for (int m = 0; m < (int) movies.size() && !found; m++) {
+        if (m + kPrefetchBatch < (int) movies.size()) db.prefetchCast(movies[m + kPrefetchBatch].movie);
+        recordList cast = db.getCastRecords(movies[m].movie);
+        stats->castLookups++;
+        for (int actor; cast.next(actor);) {
+          stats->edgesScanned++;
+          if (!actorIds.insert(make_pair(actor, (int) actors.size())).second) continue;
+          actors.push_back(actor);
+          links.push_back(movies[m]);
+
+          if (actor == targetRecord) {
+            result = buildPath(links.size() - 1, links, actors, db);
+            found = true;
+            break;
+          }
+          next.push_back(links.size() - 1);
+        }
+      }
+    }
+    stats->endLevel();
+    frontier.swap(next);
+  }
+  stats->visitedBytes = actorIds.size() * (sizeof(pair<const int, int>) + kTreeNodeOverhead) +
+    seenFilms.size() * (sizeof(int) + kTreeNodeOverhead) +
+    actors.capacity() * sizeof(int) + (links.capacity() + movies.capacity()) * sizeof(predecessor);
+  return found;
+}
+
+bool findShortestPath(const graph& g, const landmarkOracle *oracle, int source, int target,
+                      path& result, int maxDegrees, const queryFilter *filter, searchStats *stats)
+{
+  searchStats local;
+  if (stats == NULL) stats = &local;
+  stats->method = "graph";
+  if (filter != NULL && !filter->isRestrictive()) filter = NULL;
+  if (filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target)))
+    return false;
+  int limit = maxDegrees;
+  if (oracle != NULL) {
+    int lower, upper;
+    oracle->getBounds(source, target, lower, upper);
+    if (lower > limit) return false;
+    if (filter == NULL) limit = min(limit, upper);
+  }
+
+  map<int, predecessor> links;       // actor id -> how it was reached
+  set<int> seenFilms;
+  predecessor root = { source, -1 };
+  links[source] = root;
+
+  bool found = false;
+  vector<int> frontier(1, source), next;
+  for (int depth = 0; depth < limit && !frontier.empty() && !found; depth++) {
+    stats->startLevel(frontier.size());
+    next.clear();
+    for (int f = 0; f < (int) frontier.size() && !found; f++) {
+      stats->nodesExpanded++;
+      stats->creditLookups++;
+      const int *lastCredit = g.creditsEnd(frontier[f]);
+      for (const int *movie = g.creditsBegin(frontier[f]); movie != lastCredit && !found; movie++) {
+        if (filter != NULL && !filter->allowsMovie(*movie)) continue;
+        if (!seenFilms.insert(*movie).second) continue;
+        stats->castLookups++;
+        for (const int *actor = g.castBegin(*movie); actor != g.castEnd(*movie); actor++) {
+          stats->edgesScanned++;
+          if (filter != NULL && !filter->allowsActor(*actor)) continue;
+          predecessor link = { frontier[f], *movie };
+          if (!links.insert(make_pair(*actor, link)).second) continue;
+          if (*actor == target) {
+            found = true;
+            break;
+          }
+          if (oracle != NULL && depth + 1 + oracle->getLowerBound(*actor, target) > limit) continue;
+          next.push_back(*actor);
+        }
+      }
+    }
+    stats->endLevel();
+    frontier.swap(next);
+  }
+  stats->visitedBytes = links.size() * (sizeof(pair<const int, predecessor>) + kTreeNodeOverhead) +
+    seenFilms.size() * (sizeof(int) + kTreeNodeOverhead);
+  if (!found) return false;
+
+  vector<int> chain;
+  for (int cur = target; cur != source; cur = links[cur].parent) chain.push_back(cur);
+  result = path(g.getActorName(source));
+  for (int i = (int) chain.size() - 1; i >= 0; i--)
+    result.addConnection(g.getMovie(links[chain[i]].movie), g.getActorName(chain[i]));
+  return true;
+}
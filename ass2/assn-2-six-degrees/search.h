@@ -0,0 +1,119 @@
+#ifndef __search__
+#define __search__
+
+#include "imdb.h"
+#include "graph.h"
+#include "landmark-oracle.h"
+#include "path.h"
+#include "query-filter.h"
+#include <string>
+#include <vector>
+#include <time.h>
+using namespace std;
+
+/**
+ * Constant: kMaxDegrees
+ * ---------------------
+ * The longest path, in movies, that findShortestPath looks for.
+ */
+
+static const int kMaxDegrees = 6;
+
+/**
+ * Constant: kNoDegreeLimit
+ * ------------------------
+ * Passed as maxDegrees to search for a path of any length, for callers
+ * that already know the two actors are connected.
+ */
+
+static const int kNoDegreeLimit = 1 << 30;
+
+/**
+ * Type: searchStats
+ * -----------------
+ * What one path query cost, for finding out why a slow one was slow:
+ * the actors whose neighbors were read (nodesExpanded), the neighbor
+ * entries examined (edgesScanned), the credit and cast lists looked up,
+ * the largest frontier, roughly how many bytes the visited sets grew
+ * to, and how long each level of the search took.  method names the
+ * structure that answered the query ("imdb", "graph", "costars",
+ * "cache", ...), and is "none" if no search ran at all.
+ */
+
+struct searchStats {
+  const char *method;
+  long long nodesExpanded;
+  long long edgesScanned;
+  long long creditLookups;
+  long long castLookups;
+  long long peakFrontier;
+  long long visitedBytes;
+  vector<double> levelMilliseconds;
+
+  searchStats() : method("none"), nodesExpanded(0), edgesScanned(0), creditLookups(0),
+                  castLookups(0), peakFrontier(0), visitedBytes(0) {}
+
+  /**
+   * Methods: startLevel
+   *          endLevel
+   * -------------------
+   * Bracket each level of a search: the first notes the frontier's size
+   * and starts the clock, and the second records the level's time.
+   */
+
+  void startLevel(long long frontierSize);
+  void endLevel();
+
+ private:
+  struct timespec levelStart;
+};
+
+/**
+ * Function: findShortestPath
+ * --------------------------
+ * Searches the imdb for a shortest path from source to target of at
+ * most maxDegrees movies.  The search only reads the imdb, so any
+ * number of searches can run on the same imdb at once.
+ *
+ * @param db the imdb to search.
+ * @param source the name of the actor/actress the path starts with.
+ * @param target the name of the actor/actress the path should end with.
+ * @param result updated with the path, if one is found.
+ * @param maxDegrees the longest path worth looking for, in movies.
+ * @param stats if not NULL, updated with what the search cost.
+ * @return true if and only if a path was found.
+ */
+
+bool findShortestPath(const imdb& db, const string& source, const string& target, path& result,
+                      int maxDegrees = kMaxDegrees, searchStats *stats = NULL);
+
+/**
+ * Function: findShortestPath
+ * --------------------------
+ * The same search, over a graph's actor ids.  If a landmark oracle is
+ * supplied, pairs its bounds place more than maxDegrees movies apart
+ * (or in different components) are rejected without searching, the
+ * search stops at the oracle's upper bound, and actors whose lower bound
+ * to the target exceeds the remaining budget are never expanded.
+ *
+ * If a filter is supplied, movies and actors it rules out are skipped as
+ * they're reached, endpoints included.  Removing movies only lengthens
+ * paths, so the oracle's lower bounds still prune, but its upper bounds
+ * no longer apply.
+ *
+ * @param g the graph to search.
+ * @param oracle the landmark oracle for g, or NULL to search unpruned.
+ * @param source the id of the actor the path starts with.
+ * @param target the id of the actor the path should end with.
+ * @param result updated with the path, if one is found.
+ * @param maxDegrees the longest path worth looking for, in movies.
+ * @param filter the movies and actors the path may use, or NULL for all.
+ * @param stats if not NULL, updated with what the search cost.
+ * @return true if and only if a path was found.
+ */
+
+bool findShortestPath(const graph& g, const landmarkOracle *oracle, int source, int target,
+                      path& result, int maxDegrees = kMaxDegrees,
+                      const queryFilter *filter = NULL, searchStats *stats = NULL);
+
+#endif
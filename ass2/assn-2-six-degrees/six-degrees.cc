@@ -1,57 +1,311 @@
 #include <vector>
-#include <list>
-#include <set>
 #include <string>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
 #include "imdb.h"
 #include "path.h"
+#include "search.h"
+#include "bfs.h"
+#include "bfs-cache.h"
+#include "landmark-oracle.h"
+#include "component-index.h"
+#include "name-search.h"
+#include "all-paths.h"
+#include "query-filter.h"
+#include "costar-graph.h"
+#include "query-server.h"
+#include "weighted-search.h"
 using namespace std;
 
 
-// path finding method
-void generateShortestPath(string source, string target, imdb &db) {
-  list<path> partialPaths;
-  set<string> previouslySeenActors;
-  set<film> previouslySeenFilms;
+/**
+ * Type: queryContext
+ * ------------------
+ * Everything a path query may consult: the imdb itself, and optionally
+ * the graph along with a cache of search trees for popular actors and a
+ * landmark oracle.  Those three are NULL unless they were asked for.
+ * costars is NULL unless searches should skip the movie layer.
+ * filter is NULL unless queries are restricted to some movies and actors.
+ * costs is NULL unless queries want the cheapest paths rather than the
+ * shortest (see findCheapestPath).
+ * components is NULL unless the data directory has a component file.
+ * names is NULL unless batch queries should correct misspelled names.
+ * timer is NULL unless startup timing was asked for.
+ * stats is NULL unless per-query search statistics were asked for.
+ * estimateOnly asks batch queries for landmark bounds instead of paths,
+ * and a positive allPathsLimit asks every query for that many of the
+ * shortest paths (along with how many there are) instead of just one.
+ */
 
-  path start = path(source);
-  partialPaths.push_back(start);
+struct startupTimer;
+struct statsLog;
 
-  while (!partialPaths.empty() && partialPaths.front().getLength() <= 5) {
+struct queryContext {
+  const imdb *db;
+  const graph *g;
+  bfsCache *cache;
+  const landmarkOracle *oracle;
+  const costarGraph *costars;
+  const queryFilter *filter;
+  const movieCosts *costs;
+  const componentIndex *components;
+  const nameSearch *names;
+  startupTimer *timer;
+  statsLog *stats;
+  bool estimateOnly;
+  int allPathsLimit;
+};
 
-    path cur = partialPaths.front();
-    partialPaths.pop_front();
-    string last_actor = cur.getLastPlayer();
-    vector<film> movies;
-    db.getCredits(last_actor, movies);
+static double getElapsedMilliseconds(const struct timespec& start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
 
-    for (int i = 0; i < movies.size(); i++) {
+/**
+ * Type: startupTimer
+ * ------------------
+ * Measures how long a cold process takes to answer its first query: the
+ * time to open the imdb and everything else, and then the first query
+ * itself, which is usually slowed by page faults on the mapped files.
+ * Time spent waiting for the user to type isn't counted.
+ */
 
-      if (previouslySeenFilms.count(movies[i]) > 0) continue;
-      previouslySeenFilms.insert(movies[i]);
-      vector<string> cast;
-      db.getCast(movies[i], cast);
+struct startupTimer {
+  struct timespec start;
+  double openMilliseconds;
+  double readyMilliseconds;
+  int firstQueryReported;
+};
 
-      for (int j = 0; j < cast.size(); j++) {
+/**
+ * Function: reportFirstQuery
+ * --------------------------
+ * Called as each query is answered; reports on cerr, for the first one
+ * only, its latency and the total time to first query.
+ */
+
+static void reportFirstQuery(const queryContext& context, const struct timespec& queryStart)
+{
+  startupTimer *timer = context.timer;
+  if (timer == NULL || !__sync_bool_compare_and_swap(&timer->firstQueryReported, 0, 1)) return;
+  double latency = getElapsedMilliseconds(queryStart);
+  cerr << fixed << setprecision(3) << "Opened the imdb in " << timer->openMilliseconds
+       << " ms and was ready in " << timer->readyMilliseconds << " ms; the first query took "
+       << latency << " ms, for " << timer->readyMilliseconds + latency
+       << " ms to first query." << endl;
+}
 
-        if (previouslySeenActors.count(cast[j]) > 0) continue;
-        previouslySeenActors.insert(cast[j]);
-        path tmp = cur;
-        tmp.addConnection(movies[i], cast[j]);
+/**
+ * Type: statsLog
+ * --------------
+ * Where per-query search statistics go: a one-line summary on cerr if
+ * summary is set, and a JSON object per line to json if it isn't NULL.
+ * Server workers share it, so writes are serialized through lock.
+ */
 
-        if (cast[j] == target) {
-          cout << tmp << endl;
-          return;
-        }
-        partialPaths.push_back(tmp);
-        
-      }      
-    }    
+struct statsLog {
+  bool summary;
+  ostream *json;
+  pthread_mutex_t lock;
+};
+
+static string quoteJson(const string& text)
+{
+  string quoted = "\"";
+  for (int i = 0; i < (int) text.size(); i++) {
+    unsigned char ch = text[i];
+    if (ch == '"' || ch == '\\') {
+      quoted += '\\';
+      quoted += ch;
+    } else if (ch < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", ch);
+      quoted += escape;
+    } else {
+      quoted += ch;
+    }
+  }
+  return quoted + "\"";
+}
+
+/**
+ * Function: recordStats
+ * ---------------------
+ * Writes out what one query cost, if statistics were asked for.  length
+ * is the number of movies in the path found, or -1 if there wasn't one,
+ * and milliseconds is the time to answer the whole query.
+ */
+
+static void recordStats(const queryContext& context, const string& source, const string& target,
+                        int length, double milliseconds, const searchStats& stats)
+{
+  statsLog *log = context.stats;
+  if (log == NULL) return;
+  ostringstream summary, json;
+  summary << fixed << setprecision(3);
+  json << fixed << setprecision(3);
+  summary << source << " -> " << target << " (" << stats.method << "): " << length << " movies in "
+          << milliseconds << " ms; " << stats.nodesExpanded << " actors expanded, "
+          << stats.edgesScanned << " edges scanned, " << stats.creditLookups << " credit and "
+          << stats.castLookups << " cast lookups, peak frontier " << stats.peakFrontier << ", "
+          << stats.visitedBytes / 1024.0 << " KB visited; per level (ms):";
+  json << "{\"source\":" << quoteJson(source) << ",\"target\":" << quoteJson(target)
+       << ",\"method\":\"" << stats.method << "\",\"length\":" << length
+       << ",\"milliseconds\":" << milliseconds << ",\"nodesExpanded\":" << stats.nodesExpanded
+       << ",\"edgesScanned\":" << stats.edgesScanned << ",\"creditLookups\":" << stats.creditLookups
+       << ",\"castLookups\":" << stats.castLookups << ",\"peakFrontier\":" << stats.peakFrontier
+       << ",\"visitedBytes\":" << stats.visitedBytes << ",\"levelMilliseconds\":[";
+  for (int i = 0; i < (int) stats.levelMilliseconds.size(); i++) {
+    summary << " " << stats.levelMilliseconds[i];
+    json << (i == 0 ? "" : ",") << stats.levelMilliseconds[i];
   }
-  cout << endl << "No path between those two people could be found." << endl << endl;  
+  if (stats.levelMilliseconds.empty()) summary << " none";
+  json << "]}";
+
+  pthread_mutex_lock(&log->lock);
+  if (log->summary) cerr << summary.str() << endl;
+  if (log->json != NULL) *log->json << json.str() << endl;
+  pthread_mutex_unlock(&log->lock);
 }
 
+/**
+ * Function: getDegreeLimit
+ * ------------------------
+ * Decides how far to search for a path between the two actors.  Without
+ * component labels that's kMaxDegrees movies.  With them, actors in
+ * different components are turned away without searching at all, and
+ * actors in the same component are known to be connected, so the search
+ * runs to whatever depth it takes.
+ *
+ * @return false if and only if the actors are known not to be connected.
+ */
+
+static bool getDegreeLimit(const queryContext& context, const string& source,
+                           const string& target, int& maxDegrees)
+{
+  maxDegrees = kMaxDegrees;
+  if (context.components == NULL) return true;
+  if (!context.components->areConnected(source, target)) return false;
+  maxDegrees = kNoDegreeLimit;
+  return true;
+}
+
+/**
+ * Function: searchForPath
+ * -----------------------
+ * Answers a path query from the cache if it can, and otherwise by
+ * searching: over the co-star graph if there is one, over the graph with
+ * landmark pruning if there's an oracle, or over the imdb itself.  Filtered
+ * queries always search the graph, since cached trees were grown over
+ * every movie and a co-star edge keeps only one of the movies behind it.
+ * See getDegreeLimit for how far it looks.  stats records what the
+ * search cost; its method is "components" if the pair was turned away
+ * without one, and "cache" if the cache answered.
+ *
+ * With movie costs, the query is for the cheapest path instead, which is
+ * always searched for over the graph, as far as it takes, with A* if
+ * there's an oracle; cost is then updated with the path's total cost.
+ */
+
+static bool searchForPath(const queryContext& context, const string& source,
+                          const string& target, path& result, searchStats& stats,
+                          long long& cost)
+{
+  int maxDegrees;
+  if (!getDegreeLimit(context, source, target, maxDegrees)) {
+    stats.method = "components";
+    return false;
+  }
+
+  if (context.costs != NULL)
+    return findCheapestPath(*context.g, *context.costs, context.g->getActorId(source),
+                            context.g->getActorId(target), result, cost, context.oracle,
+                            context.filter, &stats);
+
+  if (context.filter != NULL)
+    return findShortestPath(*context.g, context.oracle, context.g->getActorId(source),
+                            context.g->getActorId(target), result, maxDegrees, context.filter,
+                            &stats);
+  bool found;
+  if (context.cache != NULL &&
+      context.cache->findShortestPath(source, target, result, found, maxDegrees)) {
+    stats.method = "cache";
+    return found;
+  }
+  if (context.costars != NULL)
+    return findShortestPath(*context.costars, context.g->getActorId(source),
+                            context.g->getActorId(target), result, maxDegrees, &stats);
+  if (context.oracle != NULL)
+    return findShortestPath(*context.g, context.oracle, context.g->getActorId(source),
+                            context.g->getActorId(target), result, maxDegrees, NULL, &stats);
+  return findShortestPath(*context.db, source, target, result, maxDegrees, &stats);
+}
+
+/**
+ * Function: generateShortestPath
+ * ------------------------------
+ * Looks for the shortest path between the two actors (or the cheapest,
+ * along with its cost) and prints it, or explains that there isn't one
+ * (see searchForPath for how far it looks).
+ */
+
+void generateShortestPath(const string& source, const string& target, const queryContext& context)
+{
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (context.allPathsLimit > 0) {
+    int maxDegrees;
+    int length = -1;
+    string count = "0";
+    if (getDegreeLimit(context, source, target, maxDegrees)) {
+      allShortestPaths paths(*context.g, context.g->getActorId(source),
+                             context.g->getActorId(target), maxDegrees, context.filter);
+      length = paths.getLength();
+      count = paths.getCount();
+      reportFirstQuery(context, start);
+      if (paths.found()) {
+        cout << "There " << (count == "1" ? "is 1 shortest path" : "are " + count + " shortest paths")
+             << " of " << length << " movies between them";
+        if (count != "1") cout << "; here are up to " << context.allPathsLimit << " of them";
+        cout << ":" << endl << endl;
+        path result(source);
+        for (int i = 0; i < context.allPathsLimit && paths.next(result); i++)
+          cout << result << endl;
+        return;
+      }
+    }
+    cout << endl << "No path between those two people could be found." << endl << endl;
+    return;
+  }
+
+  path result(source);
+  searchStats stats;
+  long long cost;
+  bool found = searchForPath(context, source, target, result, stats, cost);
+  reportFirstQuery(context, start);
+  recordStats(context, source, target, found ? result.getLength() : -1,
+              getElapsedMilliseconds(start), stats);
+  if (found) {
+    cout << result;
+    if (context.costs != NULL) cout << "That path costs " << cost << "." << endl;
+    cout << endl;
+  } else {
+    cout << endl << "No path between those two people could be found." << endl << endl;
+  }
+}
+
+static const int kSuggestionCount = 5;
+static const int kMaxTypos = 2;
 
 /**
  * Using the specified prompt, requests that the user supply
@@ -59,69 +313,660 @@ void generateShortestPath(string source, string target, imdb &db) {
  * once the user has supplied a name for which some record within
  * the referenced imdb existsif (or if the user just hits return,
  * which is a signal that the empty string should just be returned.)
+ * Names that aren't found are answered with a numbered list of
+ * completions and near misses, any of which can be picked by number.
  *
  * @param prompt the text that should be used for the meaningful
  *               part of the user prompt.
  * @param db a reference to the imdb which can be used to confirm
  *           that a user's response is a legitimate one.
+ * @param names the search used to suggest alternatives to bad names.
  * @return the name of the user-supplied actor or actress, or the
  *         empty string.
  */
 
-static string promptForActor(const string& prompt, const imdb& db)
+static string promptForActor(const string& prompt, const imdb& db, const nameSearch& names)
 {
   string response;
+  vector<string> suggestions;
   while (true) {
     cout << prompt << " [or <enter> to quit]: ";
     getline(cin, response);
     if (response == "") return "";
-    vector<film> credits;
-    if (db.getCredits(response, credits)) return response;
-    cout << "We couldn't find \"" << response << "\" in the movie database. "
-	 << "Please try again." << endl;
+    if (db.findActor(response.c_str()) != -1) return response;
+    int choice = atoi(response.c_str());
+    if (choice >= 1 && choice <= (int) suggestions.size()) return suggestions[choice - 1];
+
+    vector<string> nearMisses;
+    names.complete(response, kSuggestionCount, suggestions);
+    names.suggest(response, kMaxTypos, kSuggestionCount, nearMisses);
+    for (int i = 0; i < (int) nearMisses.size() && (int) suggestions.size() < kSuggestionCount; i++)
+      if (find(suggestions.begin(), suggestions.end(), nearMisses[i]) == suggestions.end())
+        suggestions.push_back(nearMisses[i]);
+
+    cout << "We couldn't find \"" << response << "\" in the movie database. ";
+    if (suggestions.empty()) {
+      cout << "Please try again." << endl;
+      continue;
+    }
+    cout << "Did you mean:" << endl;
+    for (int i = 0; i < (int) suggestions.size(); i++)
+      cout << "    " << i + 1 << ") " << suggestions[i] << endl;
+    cout << "Enter a number to pick one, or try again." << endl;
   }
 }
 
 /**
- * Serves as the main entry point for the six-degrees executable.
- * There are no parameters to speak of.
+ * Type: batchQuery
+ * ----------------
+ * One line of a batch file, together with its answer: the text to print
+ * for it, the number of movies in the path (-1 if none), how long the
+ * search took and what it cost.
+ */
+
+struct batchQuery {
+  string source;
+  string target;
+  string answer;
+  int length;
+  double latency;   // in milliseconds
+  searchStats stats;
+};
+
+/**
+ * Type: batchState
+ * ----------------
+ * What the batch workers share: the read-only imdb and the current block
+ * of queries, handed out one at a time through an atomic cursor.
+ */
+
+struct batchState {
+  const queryContext *context;
+  vector<batchQuery> *queries;
+  int cursor;
+};
+
+static const int kBatchBlockSize = 4096;
+
+/**
+ * Function: answerQuery
+ * ---------------------
+ * Answers one batch query.  The answer is a header line with the two
+ * names and the number of movies between them (-1 if there's no path,
+ * or either name is unknown), followed by the path itself, formatted
+ * as the interactive mode prints it.  Path lines start with a tab and
+ * header lines never do.
  *
- * @param argc the number of tokens passed to the command line to
- *             invoke this executable.  It's completely ignored
- *             here, because we don't expect any arguments.
- * @param argv the C strings making up the full command line.
- *             We expect argv[0] to be logically equivalent to
- *             "six-degrees" (or whatever absolute path was used to
- *             invoke the program), but otherwise these are ignored
- *             as well.
- * @return 0 if the program ends normally, and undefined otherwise.
+ * In estimate mode the answer is a single line with the two names and the
+ * oracle's lower and upper bounds, where "inf" stands for infinity.  In
+ * all-paths mode the header also has the number of shortest paths, and
+ * up to the limit of them follow, one after another.  With movie costs,
+ * the header also has the path's total cost (-1 if there's no path).
+ *
+ * With name correction on, an unknown name is replaced by the one actor
+ * closest to it in spelling, if there is one, before answering.  The
+ * header still shows the names as given; the path shows the real ones.
  */
 
-int main(int argc, const char *argv[])
+static void answerQuery(const queryContext& context, batchQuery& query)
 {
-  imdb db(determinePathToData(argv[1])); // inlined in imdb-utils.h
-  if (!db.good()) {
-    cout << "Failed to properly initialize the imdb database." << endl;
-    cout << "Please check to make sure the source files exist and that you have permission to read them." << endl;
+  const imdb& db = *context.db;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  ostringstream answer;
+  answer << query.source << "\t" << query.target << "\t";
+  string source = query.source, target = query.target;
+  if (context.names != NULL) {
+    string resolved = context.names->resolve(source, kMaxTypos);
+    if (resolved != "") source = resolved;
+    resolved = context.names->resolve(target, kMaxTypos);
+    if (resolved != "") target = resolved;
+  }
+
+  path result(source);
+  query.length = -1;
+  string costField = context.costs != NULL ? "\t-1" : "";
+  long long cost;
+  if (context.estimateOnly && db.findActor(source.c_str()) != -1 &&
+      db.findActor(target.c_str()) != -1) {
+    int lower, upper;
+    context.oracle->getBounds(context.g->getActorId(source),
+                              context.g->getActorId(target), lower, upper);
+    if (context.components != NULL && !context.components->areConnected(source, target))
+      lower = upper = kUnreachable;
+    if (lower == kUnreachable) answer << "inf"; else answer << lower;
+    answer << "\t";
+    if (upper == kUnreachable) answer << "inf"; else answer << upper;
+    answer << endl;
+  } else if (source == target && db.findActor(source.c_str()) != -1) {
+    query.length = 0;
+    answer << 0 << (context.allPathsLimit > 0 ? "\t1" : "") << (context.costs != NULL ? "\t0" : "")
+           << endl;
+  } else if (db.findActor(source.c_str()) == -1 || db.findActor(target.c_str()) == -1) {
+    answer << -1 << (context.allPathsLimit > 0 ? "\t0" : "") << costField << endl;
+  } else if (context.allPathsLimit > 0) {
+    int maxDegrees;
+    if (getDegreeLimit(context, source, target, maxDegrees)) {
+      allShortestPaths paths(*context.g, context.g->getActorId(source),
+                             context.g->getActorId(target), maxDegrees, context.filter);
+      query.length = paths.getLength();
+      answer << paths.getLength() << "\t" << paths.getCount() << endl;
+      for (int i = 0; i < context.allPathsLimit && paths.next(result); i++) answer << result;
+    } else {
+      answer << -1 << "\t" << 0 << endl;
+    }
+  } else if (searchForPath(context, source, target, result, query.stats, cost)) {
+    query.length = result.getLength();
+    answer << result.getLength();
+    if (context.costs != NULL) answer << "\t" << cost;
+    answer << endl << result;
+  } else {
+    answer << -1 << costField << endl;
+  }
+  query.answer = answer.str();
+  query.latency = getElapsedMilliseconds(start);
+  reportFirstQuery(context, start);
+}
+
+static void *answerQueries(void *arg)
+{
+  batchState *state = (batchState *) arg;
+  int size = state->queries->size();
+  while (true) {
+    int next = __sync_fetch_and_add(&state->cursor, 1);
+    if (next >= size) break;
+    answerQuery(*state->context, (*state->queries)[next]);
+  }
+  return NULL;
+}
+
+/**
+ * Function: answerBlock
+ * ---------------------
+ * Answers a block of queries on numThreads threads (the calling thread
+ * being one of them), all sharing the one mapped imdb.
+ */
+
+static void answerBlock(const queryContext& context, vector<batchQuery>& queries, int numThreads)
+{
+  batchState state = { &context, &queries, 0 };
+  vector<pthread_t> threads(numThreads);
+  vector<bool> started(numThreads, false);
+  for (int i = 1; i < numThreads; i++)
+    started[i] = pthread_create(&threads[i], NULL, answerQueries, &state) == 0;
+  answerQueries(&state);
+  for (int i = 1; i < numThreads; i++)
+    if (started[i]) pthread_join(threads[i], NULL);
+}
+
+static double getPercentile(const vector<double>& sorted, double fraction)
+{
+  if (sorted.empty()) return 0;
+  int index = (int) (fraction * (sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+/**
+ * Function: runBatch
+ * ------------------
+ * Reads tab-separated (source, target) pairs from the named file, one pair
+ * per line, and prints their answers (and any statistics) in input
+ * order.  Lines are read and answered a block at a time, so memory use
+ * doesn't grow with the file.  Throughput and latency percentiles are
+ * reported on cerr at the end.
+ *
+ * @return 0 if the file could be read, and 1 otherwise.
+ */
+
+static int runBatch(const queryContext& context, const string& fileName, int numThreads)
+{
+  ifstream infile(fileName.c_str());
+  if (infile.fail()) {
+    cerr << "Couldn't open the batch file \"" << fileName << "\"." << endl;
     return 1;
   }
-  
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  vector<double> latencies;
+  vector<batchQuery> queries;
+  int lineNumber = 0;
+  string line;
+  while (!infile.eof()) {
+    queries.clear();
+    while ((int) queries.size() < kBatchBlockSize && getline(infile, line)) {
+      lineNumber++;
+      if (line == "") continue;
+      size_t tab = line.find('\t');
+      if (tab == string::npos) {
+        cerr << fileName << ":" << lineNumber << ": expected two tab-separated names." << endl;
+        continue;
+      }
+      batchQuery query;
+      query.source = line.substr(0, tab);
+      query.target = line.substr(tab + 1);
+      queries.push_back(query);
+    }
+
+    answerBlock(context, queries, numThreads);
+    for (int i = 0; i < (int) queries.size(); i++) {
+      cout << queries[i].answer;
+      latencies.push_back(queries[i].latency);
+      recordStats(context, queries[i].source, queries[i].target, queries[i].length,
+                  queries[i].latency, queries[i].stats);
+    }
+  }
+  cout.flush();
+
+  double seconds = getElapsedMilliseconds(start) / 1e3;
+  sort(latencies.begin(), latencies.end());
+  cerr << fixed << setprecision(3);
+  cerr << "Answered " << latencies.size() << " queries in " << seconds << " s ("
+       << (seconds > 0 ? latencies.size() / seconds : 0) << " queries/sec) on "
+       << numThreads << " threads." << endl;
+  cerr << "Latency (ms): p50 " << getPercentile(latencies, 0.50)
+       << "  p90 " << getPercentile(latencies, 0.90)
+       << "  p99 " << getPercentile(latencies, 0.99)
+       << "  p99.9 " << getPercentile(latencies, 0.999)
+       << "  max " << (latencies.empty() ? 0 : latencies.back()) << endl;
+  return 0;
+}
+
+/**
+ * Function: handleRequest
+ * -----------------------
+ * Answers one request to the query server (see serveRequests).  Requests
+ * are tab-separated lines:
+ *
+ *     path <source> <target>    answered just as a --batch line is
+ *     credits <actor>           "credits", the actor and the number of movies,
+ *                               then a line per movie: a tab, the title, a
+ *                               tab and the year
+ *     cast <title> <year>       "cast", the title, the year and the number of
+ *                               actors, then a line per actor: a tab and the name
+ *     movies <title>            "movies", the title and the number of movies
+ *                               with it, then a line per movie, oldest first: a
+ *                               tab, the year, a tab and the size of the cast
+ *
+ * The count is -1 for unknown actors and movies, and titles no movie
+ * has.  Every response ends with an empty line, so a client can read
+ * answers without knowing how many lines each mode produces.
+ */
+
+static string handleRequest(const string& request, void *auxData)
+{
+  const queryContext& context = *(const queryContext *) auxData;
+  vector<string> fields;
+  istringstream tokens(request);
+  for (string field; getline(tokens, field, '\t');) fields.push_back(field);
+
+  ostringstream answer;
+  if (fields.size() == 3 && fields[0] == "path") {
+    batchQuery query;
+    query.source = fields[1];
+    query.target = fields[2];
+    answerQuery(context, query);
+    recordStats(context, query.source, query.target, query.length, query.latency, query.stats);
+    answer << query.answer;
+  } else if (fields.size() == 2 && fields[0] == "credits") {
+    vector<film> films;
+    bool found = context.db->getCredits(fields[1], films);
+    answer << "credits\t" << fields[1] << "\t" << (found ? (int) films.size() : -1) << endl;
+    for (int i = 0; i < (int) films.size(); i++)
+      answer << "\t" << films[i].title << "\t" << films[i].year << endl;
+  } else if (fields.size() == 3 && fields[0] == "cast") {
+    film movie;
+    movie.title = fields[1];
+    movie.year = atoi(fields[2].c_str());
+    vector<string> players;
+    bool found = context.db->getCast(movie, players);
+    answer << "cast\t" << fields[1] << "\t" << fields[2] << "\t"
+           << (found ? (int) players.size() : -1) << endl;
+    for (int i = 0; i < (int) players.size(); i++) answer << "\t" << players[i] << endl;
+  } else if (fields.size() == 2 && fields[0] == "movies") {
+    vector<int> records;
+    int count = context.db->findMovies(fields[1].c_str(), records);
+    answer << "movies\t" << fields[1] << "\t" << (count > 0 ? count : -1) << endl;
+    for (int i = 0; i < count; i++)
+      answer << "\t" << context.db->getMovieYear(records[i]) << "\t"
+             << context.db->getCastRecords(records[i]).size() << endl;
+  } else {
+    answer << "error\tExpected path, credits, cast or movies, with tab-separated arguments." << endl;
+  }
+  answer << endl;
+  return answer.str();
+}
+
+/**
+ * Function: playInteractively
+ * ---------------------------
+ * Repeatedly prompts for two actors and prints the shortest path between
+ * them, until the user hits return at either prompt.
+ */
+
+static void playInteractively(const queryContext& context)
+{
+  const imdb& db = *context.db;
+  nameSearch names(db);
   while (true) {
-    string source = promptForActor("Actor or actress", db);
+    string source = promptForActor("Actor or actress", db, names);
     if (source == "") break;
-    string target = promptForActor("Another actor or actress", db);
+    string target = promptForActor("Another actor or actress", db, names);
     if (target == "") break;
     if (source == target) {
       cout << "Good one.  This is only interesting if you specify two different people." << endl;
     } else {
       // replace the following line by a call to your generateShortestPath routine... 
       //vector<path> connection;
-      generateShortestPath(source, target, db);
+      generateShortestPath(source, target, context);
     }
 
   }
   
   cout << "Thanks for playing!" << endl;
-  return 0;
 }
 
+/**
+ * Function: parseMapHints
+ * -----------------------
+ * Translates the argument to --map into imdb options, returning false if
+ * it names a hint that doesn't exist.
+ */
+
+static bool parseMapHints(const string& hints, int& options)
+{
+  static const struct { const char *name; int option; } kHints[] = {
+    { "populate", imdb::kPopulate }, { "warmup", imdb::kWarmup },
+    { "random", imdb::kAdviseRandom }, { "willneed", imdb::kAdviseWillNeed },
+    { "hugepages", imdb::kHugePages }
+  };
+  istringstream tokens(hints);
+  string hint;
+  while (getline(tokens, hint, ',')) {
+    int i = 0, count = sizeof(kHints) / sizeof(kHints[0]);
+    while (i < count && hint != kHints[i].name) i++;
+    if (i == count) return false;
+    options |= kHints[i].option;
+  }
+  return true;
+}
+
+/**
+ * Function: parseWeights
+ * ----------------------
+ * Translates the argument to --weights into the cast and age weights,
+ * returning false if it's malformed.
+ */
+
+static bool parseWeights(const string& weights, int& castWeight, int& ageWeight)
+{
+  castWeight = ageWeight = 0;
+  istringstream tokens(weights);
+  string setting;
+  while (getline(tokens, setting, ',')) {
+    int value;
+    char extra;
+    if (sscanf(setting.c_str(), "cast=%d%c", &value, &extra) == 1 && value >= 0) castWeight = value;
+    else if (sscanf(setting.c_str(), "age=%d%c", &value, &extra) == 1 && value >= 0) ageWeight = value;
+    else return false;
+  }
+  return true;
+}
+
+/**
+ * Function: buildCostars
+ * ----------------------
+ * Builds the co-star graph and reports on cerr what it cost, in time and
+ * in memory beside the graph's own.
+ */
+
+static costarGraph *buildCostars(const graph& g, int numThreads)
+{
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  costarGraph *costars = new costarGraph(g, numThreads);
+  cerr << fixed << setprecision(1) << "Built the co-star graph in " << getElapsedMilliseconds(start)
+       << " ms on " << numThreads << " threads: " << costars->getEdgeCount() << " co-star pairs in "
+       << costars->getMemoryUsage() / 1048576.0 << " MB, beside " << g.getMemoryUsage() / 1048576.0
+       << " MB for the " << g.getEdgeCount() << " credits." << endl;
+  return costars;
+}
+
+/**
+ * Function: configureFilter
+ * -------------------------
+ * Applies the arguments to --years, --exclude-movies and --exclude-actors,
+ * any of which may be NULL, to the filter.  Problems are reported on cerr.
+ *
+ * @return false if and only if an argument was malformed or unreadable.
+ */
+
+static bool configureFilter(queryFilter& filter, const char *yearRange,
+                            const char *excludedMovies, const char *excludedActors)
+{
+  if (yearRange != NULL) {
+    int firstYear, lastYear;
+    char extra;
+    if (sscanf(yearRange, "%d-%d%c", &firstYear, &lastYear, &extra) != 2) {
+      cerr << "Expected --years <first>-<last>, as in --years 1980-2000." << endl;
+      return false;
+    }
+    filter.setYearRange(firstYear, lastYear);
+  }
+  const char *files[] = { excludedMovies, excludedActors };
+  for (int i = 0; i < 2; i++) {
+    if (files[i] != NULL && !filter.excludeFromFile(files[i], i == 0)) {
+      cerr << "Couldn't open the exclusion file \"" << files[i] << "\"." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Serves as the main entry point for the six-degrees executable.
+ * With no arguments, it repeatedly prompts for pairs of actors and prints
+ * the shortest path between them.  The flags understood are:
+ *
+ *     --search-index   build the imdb's in-memory search index at startup,
+ *                      trading a little startup time for faster name lookups
+ *     --batch <file>   answer every tab-separated pair in the file instead
+ *                      of prompting (see runBatch)
+ *     --threads <n>    number of threads to use for --batch (default: one
+ *                      per core)
+ *     --cache <mb>     keep up to <mb> megabytes of complete search trees for
+ *                      actors that queries keep starting from (see bfsCache)
+ *     --cache-file <file>  load the cache from the file at startup, if it
+ *                      exists, and save it back there on exit
+ *     --landmarks      prune searches with the landmark file in the data
+ *                      directory (see landmarkOracle and imdb-index)
+ *     --estimate       with --landmarks and --batch or --serve, answer each
+ *                      pair with distance bounds instead of a path
+ *     --fuzzy          with --batch, replace each unknown name with the
+ *                      closest actor's name, if it's within a few typos
+ *     --map <hints>    how to map the data files: a comma-separated list of
+ *                      populate, warmup, random, willneed and hugepages
+ *                      (see the imdb constructor)
+ *     --timing         report startup time and time to first query on cerr
+ *     --all-paths <n>  count the shortest paths for each pair, and print
+ *                      the first <n> of them instead of just one
+ *     --years <first>-<last>  only connect actors through movies released
+ *                      in those years, inclusive
+ *     --exclude-movies <file>  never connect actors through the movies
+ *                      listed in the file, one title, tab and year per line
+ *     --exclude-actors <file>  never pass through the actors named in the
+ *                      file, one per line (see queryFilter)
+ *     --costars        search the materialized co-star graph, which takes
+ *                      more memory but skips the movies (see costarGraph)
+ *     --serve <socket> instead of prompting, answer requests from any number
+ *                      of clients over a Unix socket at that path, on
+ *                      --threads workers, until interrupted (see handleRequest)
+ *     --weights cast=<n>,age=<n>  find the cheapest paths rather than the
+ *                      shortest, where a movie costs more the bigger its
+ *                      cast and the older it is (see movieCosts); either
+ *                      weight may be left out, and is then 0.  Searches use
+ *                      A* with --landmarks, and can't be combined with
+ *                      --all-paths
+ *     --stats          after each path query, summarize on cerr what the
+ *                      search cost (see searchStats)
+ *     --stats-json <file>  write the same statistics to the file, one JSON
+ *                      object per query and per line
+ *
+ * If the data directory holds a component file (see componentIndex and
+ * imdb-index), it's always used: disconnected pairs are rejected at once,
+ * and connected pairs are searched past kMaxDegrees movies.
+ *
+ * @param argc the number of tokens passed to the command line to
+ *             invoke this executable.
+ * @param argv the C strings making up the full command line.
+ *             We expect argv[0] to be logically equivalent to
+ *             "six-degrees" (or whatever absolute path was used to
+ *             invoke the program), followed by the flags above.
+ * @return 0 if the program ends normally, and undefined otherwise.
+ */
+
+int main(int argc, const char *argv[])
+{
+  startupTimer timer;
+  clock_gettime(CLOCK_MONOTONIC, &timer.start);
+  timer.firstQueryReported = 0;
+  bool reportTiming = false;
+  int options = 0;
+  const char *batchFile = NULL;
+  int numThreads = 0;
+  int cacheMegabytes = 0;
+  const char *cacheFile = NULL;
+  bool useLandmarks = false;
+  bool estimateOnly = false;
+  bool fuzzyNames = false;
+  int allPathsLimit = 0;
+  const char *yearRange = NULL;
+  const char *excludedMovies = NULL;
+  const char *excludedActors = NULL;
+  bool useCostars = false;
+  const char *socketPath = NULL;
+  const char *weights = NULL;
+  bool summarizeStats = false;
+  const char *statsFile = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--search-index") == 0) options |= imdb::kSearchIndex;
+    else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) batchFile = argv[++i];
+    else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) numThreads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) cacheMegabytes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--cache-file") == 0 && i + 1 < argc) cacheFile = argv[++i];
+    else if (strcmp(argv[i], "--landmarks") == 0) useLandmarks = true;
+    else if (strcmp(argv[i], "--costars") == 0) useCostars = true;
+    else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) socketPath = argv[++i];
+    else if (strcmp(argv[i], "--estimate") == 0) estimateOnly = true;
+    else if (strcmp(argv[i], "--fuzzy") == 0) fuzzyNames = true;
+    else if (strcmp(argv[i], "--timing") == 0) reportTiming = true;
+    else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) weights = argv[++i];
+    else if (strcmp(argv[i], "--stats") == 0) summarizeStats = true;
+    else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) statsFile = argv[++i];
+    else if (strcmp(argv[i], "--all-paths") == 0 && i + 1 < argc) allPathsLimit = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--years") == 0 && i + 1 < argc) yearRange = argv[++i];
+    else if (strcmp(argv[i], "--exclude-movies") == 0 && i + 1 < argc) excludedMovies = argv[++i];
+    else if (strcmp(argv[i], "--exclude-actors") == 0 && i + 1 < argc) excludedActors = argv[++i];
+    else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+      if (!parseMapHints(argv[++i], options)) {
+        cerr << "Unknown --map hint in \"" << argv[i] << "\"." << endl;
+        return 1;
+      }
+    }
+  }
+  if (numThreads <= 0) numThreads = getDefaultThreadCount();
+  int castWeight, ageWeight;
+  if (weights != NULL && (!parseWeights(weights, castWeight, ageWeight) || allPathsLimit > 0)) {
+    cerr << "Expected --weights cast=<n>,age=<n>, without --all-paths." << endl;
+    return 1;
+  }
+
+  imdb db(determinePathToData(argv[1]), options); // inlined in imdb-utils.h
+  if (!db.good()) {
+    cout << "Failed to properly initialize the imdb database." << endl;
+    cout << "Please check to make sure the source files exist and that you have permission to read them." << endl;
+    return 1;
+  }
+  timer.openMilliseconds = getElapsedMilliseconds(timer.start);
+
+  queryContext context = { &db, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, false,
+                           allPathsLimit };
+  ofstream statsOutput;
+  statsLog stats = { summarizeStats, NULL };
+  pthread_mutex_init(&stats.lock, NULL);
+  if (statsFile != NULL) {
+    statsOutput.open(statsFile);
+    if (statsOutput.fail()) {
+      cerr << "Couldn't open the statistics file \"" << statsFile << "\"." << endl;
+      return 1;
+    }
+    stats.json = &statsOutput;
+  }
+  if (summarizeStats || statsFile != NULL) context.stats = &stats;
+  componentIndex components(db, string(determinePathToData()) + "/" + componentIndex::kFileName);
+  if (components.good()) context.components = &components;
+  nameSearch names(db);
+  if (fuzzyNames) context.names = &names;
+  bool filtered = yearRange != NULL || excludedMovies != NULL || excludedActors != NULL;
+  graph *g = NULL;
+  if (cacheMegabytes > 0 || useLandmarks || allPathsLimit > 0 || filtered || useCostars ||
+      weights != NULL)
+    context.g = g = new graph(db);
+  queryFilter *filter = NULL;
+  if (filtered) {
+    context.filter = filter = new queryFilter(*g);
+    if (!configureFilter(*filter, yearRange, excludedMovies, excludedActors)) {
+      delete filter;
+      delete g;
+      return 1;
+    }
+  }
+  if (cacheMegabytes > 0) {
+    // batch and server workers already run in parallel, so each cached search gets one thread
+    bool concurrent = batchFile != NULL || socketPath != NULL;
+    context.cache = new bfsCache(*g, (size_t) cacheMegabytes << 20, 2, concurrent ? 1 : numThreads);
+    if (cacheFile != NULL) context.cache->load(cacheFile);
+  }
+  movieCosts *costs = NULL;
+  if (weights != NULL) context.costs = costs = new movieCosts(*g, castWeight, ageWeight);
+  costarGraph *costars = NULL;
+  if (useCostars) context.costars = costars = buildCostars(*g, numThreads);
+  landmarkOracle *oracle = NULL;
+  if (useLandmarks) {
+    oracle = new landmarkOracle(*g, string(determinePathToData()) + "/" + landmarkOracle::kFileName);
+    if (oracle->good()) {
+      context.oracle = oracle;
+      context.estimateOnly = estimateOnly && (batchFile != NULL || socketPath != NULL);
+    } else {
+      cerr << "No landmark file matching this data was found; searching without it." << endl;
+    }
+  }
+  timer.readyMilliseconds = getElapsedMilliseconds(timer.start);
+  if (reportTiming) context.timer = &timer;
+
+  int status = 0;
+  if (socketPath != NULL) {
+    cerr << "Serving requests on " << socketPath << " with " << numThreads << " threads." << endl;
+    if (!serveRequests(socketPath, numThreads, handleRequest, &context)) {
+      cerr << "Couldn't listen on \"" << socketPath << "\"." << endl;
+      status = 1;
+    }
+  } else if (batchFile != NULL) {
+    status = runBatch(context, batchFile, numThreads);
+  } else {
+    playInteractively(context);
+  }
+
+  if (context.cache != NULL) {
+    if (cacheFile != NULL && !context.cache->save(cacheFile))
+      cerr << "Couldn't save the search cache to \"" << cacheFile << "\"." << endl;
+    delete context.cache;
+  }
+  delete oracle;
+  delete costars;
+  delete costs;
+  delete filter;
+  delete g;
+  pthread_mutex_destroy(&stats.lock);
+  return status;
+}
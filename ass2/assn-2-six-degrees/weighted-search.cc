@@ -0,0 +1,150 @@
+#include "weighted-search.h"
+#include <algorithm>
+using namespace std;
+
+static const unsigned int kInfiniteCost = 0xffffffffu;
+
+// 0 for the last key popped itself, otherwise 1 + the highest differing bit
+int radixHeap::getBucket(unsigned int key, unsigned int last)
+{
+  unsigned int differing = key ^ last;
+  if (differing == 0) return 0;
+#ifdef __GNUC__
+  return 32 - __builtin_clz(differing);
+#else
+  int bucket = 0;
+  for (; differing != 0; differing >>= 1) bucket++;
+  return bucket;
+#endif
+}
+
+void radixHeap::push(unsigned int key, int value)
+{
+  buckets[getBucket(key, last)].push_back(entry(key, value));
+  count++;
+}
+
+void radixHeap::pop(unsigned int& key, int& value)
+{
+  if (buckets[0].empty()) {
+    int i = 1;
+    while (buckets[i].empty()) i++;
+    last = buckets[i][0].first;
+    for (int j = 1; j < (int) buckets[i].size(); j++) last = min(last, buckets[i][j].first);
+    // everything in bucket i shares last's bits above bit i - 1, so it all lands lower
+    for (int j = 0; j < (int) buckets[i].size(); j++)
+      buckets[getBucket(buckets[i][j].first, last)].push_back(buckets[i][j]);
+    buckets[i].clear();
+  }
+  key = buckets[0].back().first;
+  value = buckets[0].back().second;
+  buckets[0].pop_back();
+  count--;
+}
+
+movieCosts::movieCosts(const graph& g, int castWeight, int ageWeight) :
+  costs(g.getMovieCount()), minimum(kStepCost)
+{
+  const imdb& db = g.getDatabase();
+  vector<int> years(g.getMovieCount());
+  int newest = 0;
+  for (int movie = 0; movie < g.getMovieCount(); movie++) {
+    years[movie] = db.getMovieYear(g.getMovieRecord(movie));
+    newest = max(newest, years[movie]);
+  }
+  for (int movie = 0; movie < g.getMovieCount(); movie++) {
+    int doublings = 0;
+    for (int size = g.getCastCount(movie); size > 1; size >>= 1) doublings++;
+    int decades = (newest - years[movie]) / 10;
+    costs[movie] = kStepCost + castWeight * doublings + ageWeight * decades;
+    minimum = movie == 0 ? costs[movie] : min(minimum, costs[movie]);
+  }
+}
+
+/**
+ * Function: getHeuristic
+ * ----------------------
+ * The A* estimate of what's left to pay from actor to target: 0 without
+ * an oracle, and kInfiniteCost if the oracle proves there's no path.
+ */
+
+static unsigned int getHeuristic(const landmarkOracle *oracle, unsigned int minimumCost,
+                                 int actor, int target)
+{
+  if (oracle == NULL) return 0;
+  int lower = oracle->getLowerBound(actor, target);
+  return lower == kUnreachable ? kInfiniteCost : lower * minimumCost;
+}
+
+bool findCheapestPath(const graph& g, const movieCosts& costs, int source, int target,
+                      path& result, long long& cost, const landmarkOracle *oracle,
+                      const queryFilter *filter, searchStats *stats)
+{
+  searchStats local;
+  if (stats == NULL) stats = &local;
+  stats->method = oracle == NULL ? "dijkstra" : "astar";
+  if (filter != NULL && !filter->isRestrictive()) filter = NULL;
+  if (filter != NULL && (!filter->allowsActor(source) || !filter->allowsActor(target)))
+    return false;
+  if (source == target) {
+    result = path(g.getActorName(source));
+    cost = 0;
+    return true;
+  }
+  unsigned int minimumCost = costs.getMinimumCost();
+  unsigned int estimate = getHeuristic(oracle, minimumCost, source, target);
+  if (estimate == kInfiniteCost) return false;
+
+  vector<unsigned int> best(g.getActorCount(), kInfiniteCost);
+  vector<unsigned int> movieBest(g.getMovieCount(), kInfiniteCost);   // cheapest actor to expand each
+  vector<int> parent(g.getActorCount(), -1), via(g.getActorCount(), -1);
+  vector<bool> settled(g.getActorCount(), false);
+  radixHeap heap;
+  best[source] = 0;
+  heap.push(estimate, source);
+  bool found = false;
+  while (!heap.empty()) {
+    unsigned int key;
+    int actor;
+    heap.pop(key, actor);
+    if (settled[actor]) continue;    // a stale entry, superseded by a cheaper one
+    settled[actor] = true;
+    stats->nodesExpanded++;
+    if (actor == target) {
+      found = true;
+      break;
+    }
+
+    stats->creditLookups++;
+    for (const int *movie = g.creditsBegin(actor); movie != g.creditsEnd(actor); movie++) {
+      if (filter != NULL && !filter->allowsMovie(*movie)) continue;
+      if (best[actor] >= movieBest[*movie]) continue;
+      movieBest[*movie] = best[actor];
+      stats->castLookups++;
+      unsigned int through = best[actor] + costs.getCost(*movie);
+      for (const int *costar = g.castBegin(*movie); costar != g.castEnd(*movie); costar++) {
+        stats->edgesScanned++;
+        if (settled[*costar] || through >= best[*costar]) continue;
+        if (filter != NULL && !filter->allowsActor(*costar)) continue;
+        estimate = getHeuristic(oracle, minimumCost, *costar, target);
+        if (estimate == kInfiniteCost) continue;
+        best[*costar] = through;
+        parent[*costar] = actor;
+        via[*costar] = *movie;
+        heap.push(through + estimate, *costar);
+      }
+      stats->peakFrontier = max(stats->peakFrontier, (long long) heap.size());
+    }
+  }
+  stats->visitedBytes = (best.capacity() + movieBest.capacity() + parent.capacity() +
+                         via.capacity()) * sizeof(int) + settled.capacity() / 8;
+  if (!found) return false;
+
+  vector<int> chain;
+  for (int cur = target; cur != source; cur = parent[cur]) chain.push_back(cur);
+  result = path(g.getActorName(source));
+  for (int i = (int) chain.size() - 1; i >= 0; i--)
+    result.addConnection(g.getMovie(via[chain[i]]), g.getActorName(chain[i]));
+  cost = best[target];
+  return true;
+}
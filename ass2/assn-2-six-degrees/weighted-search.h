@@ -0,0 +1,135 @@
+#ifndef __weighted_search__
+#define __weighted_search__
+
+#include "graph.h"
+#include "path.h"
+#include "search.h"
+#include "landmark-oracle.h"
+#include "query-filter.h"
+#include <vector>
+using namespace std;
+
+/**
+ * Class: radixHeap
+ * ----------------
+ * A min-priority queue of (key, value) pairs for unsigned keys, with the
+ * restriction that no key pushed may be smaller than the last key popped,
+ * which is always true of Dijkstra's algorithm, and of A* with a
+ * consistent heuristic.  Entries live in 33 buckets by the highest bit in
+ * which their key differs from the last key popped; popping refills the
+ * lowest bucket by redistributing the next nonempty one, and each entry
+ * moves down at most 32 times, so push and pop cost O(1) amortized plus
+ * O(log C) for keys spread over a range of C.
+ */
+
+class radixHeap {
+
+ public:
+  radixHeap() : last(0), count(0) {}
+
+  bool empty() const { return count == 0; }
+  int size() const { return count; }
+
+  /**
+   * Method: push
+   * ------------
+   * Adds an entry.  The key must be no smaller than the last key popped.
+   */
+
+  void push(unsigned int key, int value);
+
+  /**
+   * Method: pop
+   * -----------
+   * Removes an entry with the smallest key, which must exist, and copies
+   * it into key and value.  Entries with equal keys come out in no
+   * particular order.
+   */
+
+  void pop(unsigned int& key, int& value);
+
+ private:
+  typedef pair<unsigned int, int> entry;
+  vector<entry> buckets[33];
+  unsigned int last;
+  int count;
+
+  static int getBucket(unsigned int key, unsigned int last);
+};
+
+/**
+ * Class: movieCosts
+ * -----------------
+ * Prices every movie in a graph as a step in a path, so that searches can
+ * prefer close connections over merely short ones.  Every movie costs
+ * kStepCost, plus castWeight for each doubling of its cast (a movie with
+ * hundreds of extras says less about two actors than a two-hander), plus
+ * ageWeight for each full decade it's older than the newest movie in the
+ * graph.  With both weights 0, every movie costs the same and the
+ * cheapest paths are the shortest ones.
+ */
+
+class movieCosts {
+
+ public:
+  static const unsigned int kStepCost = 16;
+
+  /**
+   * Constructor: movieCosts
+   * -----------------------
+   * Prices every movie in the graph.  Weights must not be negative.
+   */
+
+  movieCosts(const graph& g, int castWeight, int ageWeight);
+
+  /**
+   * Methods: getCost
+   *          getMinimumCost
+   * ---------------------
+   * Return a movie's cost, and the least any movie costs, which makes a
+   * lower bound in movies into a lower bound in cost.
+   */
+
+  unsigned int getCost(int movie) const { return costs[movie]; }
+  unsigned int getMinimumCost() const { return minimum; }
+
+ private:
+  vector<unsigned int> costs;
+  unsigned int minimum;
+};
+
+/**
+ * Function: findCheapestPath
+ * --------------------------
+ * Finds a path from source to target whose movies cost the least in
+ * total, with Dijkstra's algorithm over the actors, using a radix heap.
+ * Each movie's cast is read once for every time a cheaper way to the
+ * movie turns up, which for Dijkstra is exactly once.
+ *
+ * If a landmark oracle is supplied, the search is A* instead: actors are
+ * taken in order of their cost so far plus the oracle's lower bound on
+ * the movies left to the target, times the cheapest movie's cost.  The
+ * bound never overestimates and never drops by more than one movie's
+ * cost across a movie, so the first time the target comes off the heap
+ * its cost is final, and actors the bound shows can't reach the target
+ * are never queued.  A filter rules out movies and actors as for
+ * findShortestPath.
+ *
+ * @param g the graph to search.
+ * @param costs the price of every movie in g.
+ * @param source the id of the actor the path starts with.
+ * @param target the id of the actor the path should end with.
+ * @param result updated with the path, if one is found.
+ * @param cost updated with the path's total cost, if one is found.
+ * @param oracle the landmark oracle for g, or NULL for plain Dijkstra.
+ * @param filter the movies and actors the path may use, or NULL for all.
+ * @param stats if not NULL, updated with what the search cost; the
+ *              frontier is the heap, and there are no levels to time.
+ * @return true if and only if a path was found.
+ */
+
+bool findCheapestPath(const graph& g, const movieCosts& costs, int source, int target,
+                      path& result, long long& cost, const landmarkOracle *oracle = NULL,
+                      const queryFilter *filter = NULL, searchStats *stats = NULL);
+
+#endif